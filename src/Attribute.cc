@@ -2,69 +2,47 @@
 #include "Link.h"
 #include "Node.h"
 #include "Scene.h"
+#include "Commands.h"
 #include "ThemeManager.h"
+#include "DataTypeRegistry.h"
+#include "Profiler.h"
 
 #include <QDebug>
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsTextItem>
 #include <QMargins>
+#include <QStyleOptionGraphicsItem>
 
 #include <type_traits>
 
 namespace piper
 {
-    QDataStream& operator<<(QDataStream& out, AttributeInfo const& info)
+    namespace
     {
-        out << info.name << info.dataType << info.type;
-        return out;
-    }
-
-
-    QDataStream& operator>>(QDataStream& in, AttributeInfo& info)
-    {
-        int type;
-        in >> info.name >> info.dataType >> type;
-        info.type = static_cast<AttributeInfo::Type>(type);
-        return in;
+        AttributeInfo interned(AttributeInfo info)
+        {
+            if (info.typeId == DataTypeRegistry::invalidId)
+            {
+                info.typeId = DataTypeRegistry::instance().intern(info.dataType);
+            }
+            return info;
+        }
     }
 
 
     Attribute::Attribute(QGraphicsItem* parent, AttributeInfo const& info, QRect const& boundingRect)
         : QGraphicsItem(parent)
-        , info_{info}
+        , info_{interned(info)}
         , bounding_rect_{boundingRect}
         , background_rect_{bounding_rect_}
         , label_rect_{
               bounding_rect_.left() + 15, bounding_rect_.top(), bounding_rect_.width() - 30, bounding_rect_.height()}
+        , background_brush_{&ThemeManager::instance().nodeStyle()->attribute_brush}
+        , style_{ThemeManager::instance().attributeStyle(typeId(), Mode::enable)}
     {
-        AttributeTheme theme    = ThemeManager::instance().getAttributeTheme();
-        DataTypeTheme typeTheme = ThemeManager::instance().getDataTypeTheme(dataType());
-
-        minimize_pen_.setStyle(Qt::SolidLine);
-        minimize_pen_.setWidth(theme.minimize.connector.border_width);
-        minimize_pen_.setColor(theme.minimize.connector.border_color);
-        minimize_font_ = theme.minimize.font;
-        minimize_font_pen_.setStyle(Qt::SolidLine);
-        minimize_font_pen_.setColor(theme.minimize.font_color);
-
-        normal_pen_.setStyle(Qt::SolidLine);
-        normal_pen_.setWidth(theme.normal.connector.border_width);
-        normal_pen_.setColor(theme.normal.connector.border_color);
-        normal_brush_.setStyle(Qt::SolidPattern);
-        normal_brush_.setColor(typeTheme.enable);
-        normal_font_ = theme.normal.font;
-        normal_font_pen_.setStyle(Qt::SolidLine);
-        normal_font_pen_.setColor(theme.normal.font_color);
-
-        highlight_pen_.setStyle(Qt::SolidLine);
-        highlight_pen_.setWidth(theme.highlight.connector.border_width);
-        highlight_pen_.setColor(theme.highlight.connector.border_color);
-        highlight_brush_.setStyle(Qt::SolidPattern);
-        highlight_brush_.setColor(typeTheme.enable);
-        highlight_font_ = theme.highlight.font;
-        highlight_font_pen_.setStyle(Qt::SolidLine);
-        highlight_font_pen_.setColor(theme.highlight.font_color);
+        // Label width is used by the node layout.
+        label_rect_.setWidth(QFontMetrics(style_->normal.font).width(name()));
 
         prepareGeometryChange();
     }
@@ -81,19 +59,41 @@ namespace piper
     }
 
 
-    void Attribute::setColor(QColor const& color)
+    void Attribute::setNodeMode(Mode mode)
     {
-        normal_brush_.setColor(color);
-        highlight_brush_.setColor(color);
+        style_ = ThemeManager::instance().attributeStyle(typeId(), mode);
         update();
     }
 
 
     void Attribute::connect(Link* link)
     {
-        DataTypeTheme typeTheme = ThemeManager::instance().getDataTypeTheme(dataType());
         links_.append(link);
-        link->setColor(typeTheme.enable);
+        link->setColor(ThemeManager::instance().attributeStyle(typeId(), Mode::enable)->normal.brush.color());
+
+        // The link is complete when its input is connected: register the edge.
+        Scene* pScene = static_cast<Scene*>(scene());
+        if (isInput() and (pScene != nullptr) and (link->from() != nullptr))
+        {
+            pScene->topologicalOrder().addEdge(static_cast<Node*>(link->from()->parentItem()),
+                                               static_cast<Node*>(parentItem()));
+        }
+    }
+
+
+    void Attribute::disconnect(Link* link)
+    {
+        if (links_.removeAll(link) == 0)
+        {
+            return;
+        }
+
+        Scene* pScene = static_cast<Scene*>(scene());
+        if (isInput() and (pScene != nullptr) and (link->from() != nullptr))
+        {
+            pScene->topologicalOrder().removeEdge(static_cast<Node*>(link->from()->parentItem()),
+                                                  static_cast<Node*>(parentItem()));
+        }
     }
 
 
@@ -106,9 +106,17 @@ namespace piper
 
     void Attribute::refresh()
     {
+        Scene* pScene = static_cast<Scene*>(scene());
         for (auto& link : links_)
         {
-            link->updatePath();
+            if (pScene != nullptr)
+            {
+                pScene->scheduleLinkUpdate(link); // links shared by moving nodes are updated once
+            }
+            else if (link->isConnected())
+            {
+                link->updatePath();
+            }
         }
     }
 
@@ -119,20 +127,20 @@ namespace piper
         {
             case DisplayMode::highlight:
             {
-                painter->setFont(highlight_font_);
-                painter->setPen(highlight_font_pen_);
+                painter->setFont(style_->highlight.font);
+                painter->setPen(style_->highlight.font_pen);
                 break;
             }
             case DisplayMode::normal:
             {
-                painter->setFont(normal_font_);
-                painter->setPen(normal_font_pen_);
+                painter->setFont(style_->normal.font);
+                painter->setPen(style_->normal.font_pen);
                 break;
             }
             case DisplayMode::minimize:
             {
-                painter->setFont(minimize_font_);
-                painter->setPen(minimize_font_pen_);
+                painter->setFont(style_->minimize.font);
+                painter->setPen(style_->minimize.font_pen);
                 break;
             }
         }
@@ -144,38 +152,48 @@ namespace piper
         {
             case DisplayMode::highlight:
             {
-                painter->setBrush(highlight_brush_);
-                painter->setPen(highlight_pen_);
+                painter->setBrush(style_->highlight.brush);
+                painter->setPen(style_->highlight.pen);
                 break;
             }
             case DisplayMode::normal:
             {
-                painter->setBrush(normal_brush_);
-                painter->setPen(normal_pen_);
+                painter->setBrush(style_->normal.brush);
+                painter->setPen(style_->normal.pen);
                 break;
             }
             case DisplayMode::minimize:
             {
-                painter->setBrush(background_brush_);
-                painter->setPen(minimize_pen_);
+                painter->setBrush(*background_brush_);
+                painter->setPen(style_->minimize.pen);
                 break;
             }
         }
     }
 
 
-    void Attribute::paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*)
+    bool Attribute::isLowDetail(QPainter* painter, QStyleOptionGraphicsItem const* option)
+    {
+        return option->levelOfDetailFromTransform(painter->worldTransform()) < lowDetailLevel;
+    }
+
+
+    void Attribute::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*)
     {
+        ProfileScope profile{"Attribute::paint"};
+        if (isLowDetail(painter, option))
+        {
+            return; // the node draws a simplified shape.
+        }
+
         // NodeAttribute background.
-        painter->setBrush(background_brush_);
+        painter->setBrush(*background_brush_);
         painter->setPen(Qt::NoPen);
         painter->drawRect(background_rect_);
 
         // NodeAttribute label.
         applyFontStyle(painter, mode_);
         painter->drawText(QPoint(bounding_rect_.left() + 15, bounding_rect_.top() + 20), name());
-        int labelWitdth = painter->fontMetrics().width(name());
-        label_rect_.setWidth(labelWitdth);
     }
 
 
@@ -209,12 +227,12 @@ namespace piper
     }
 
 
-    void AttributeOutput::setColor(QColor const& color)
+    void AttributeOutput::setNodeMode(Mode mode)
     {
-        Attribute::setColor(color);
+        Attribute::setNodeMode(mode);
         for (auto& link : links_)
         {
-            link->setColor(color);
+            link->setColor(style_->normal.brush.color());
         }
     }
 
@@ -242,14 +260,20 @@ namespace piper
         // Compute connector center to position the path.
         connectorPos_ = {connectorRect_->x() + connectorRect_->width() / 2.0,
                          connectorRect_->y() + connectorRect_->height() / 2.0};
+        refresh();
         update();
     }
 
 
-    void AttributeOutput::paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*)
+    void AttributeOutput::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*)
     {
+        if (isLowDetail(painter, option))
+        {
+            return; // the node draws a simplified shape.
+        }
+
         // Draw generic part (label and background).
-        Attribute::paint(painter, nullptr, nullptr);
+        Attribute::paint(painter, option, nullptr);
 
         applyStyle(painter, mode_);
         painter->drawEllipse(*connectorRect_);
@@ -264,14 +288,11 @@ namespace piper
         {
             new_connection_ = new Link();
             new_connection_->connectFrom(this);
-            new_connection_->setColor(normal_brush_.color());
+            new_connection_->setColor(style_->normal.brush.color());
             pScene->addLink(new_connection_);
 
-            for (auto const& item : pScene->nodes())
-            {
-                item->highlight(this);
-            }
-
+            pScene->highlightCompatible(this);
+            new_connection_->setZValue(dimOverlayZ + 1); // keep the dragged link visible
             return;
         }
 
@@ -308,17 +329,16 @@ namespace piper
         }
 
         // Disable highlight
-        for (auto const& item : pScene->nodes())
-        {
-            item->unhighlight();
-        }
+        pScene->clearHighlight();
 
-        AttributeInput* input = qgraphicsitem_cast<AttributeInput*>(scene()->itemAt(event->scenePos(), QTransform()));
+        AttributeInput* input = pScene->inputAt(event->scenePos());
         if (input != nullptr)
         {
             if (input->accept(this))
             {
+                new_connection_->setZValue(-1);
                 new_connection_->connectTo(input);
+                pScene->undoStack().push(new ConnectCommand(pScene, new_connection_->endpoints()));
                 new_connection_ = nullptr;  // connection finished.
                 return;
             }
@@ -385,12 +405,32 @@ namespace piper
         qreal x = input_triangle_[0].x();
         qreal y       = input_triangle_[2].y() - input_triangle_[0].y();
         connectorPos_ = {x, y};
+        refresh();
         update();
     }
 
     bool AttributeInput::accept(Attribute* attribute) const
     {
-        if (attribute->dataType() != dataType())
+        if (not isConnectable(attribute))
+        {
+            return false;
+        }
+
+        Scene* pScene = static_cast<Scene*>(scene());
+        if ((pScene != nullptr) and pScene->topologicalOrder().createsCycle(static_cast<Node*>(attribute->parentItem()),
+                                                                             static_cast<Node*>(parentItem())))
+        {
+            // The pipeline shall stay acyclic.
+            return false;
+        }
+
+        return true;
+    }
+
+
+    bool AttributeInput::isConnectable(Attribute* attribute) const
+    {
+        if (not DataTypeRegistry::instance().isCompatible(attribute->typeId(), typeId()))
         {
             // Incompatible type.
             return false;
@@ -415,10 +455,15 @@ namespace piper
     }
 
 
-    void AttributeInput::paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*)
+    void AttributeInput::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*)
     {
+        if (isLowDetail(painter, option))
+        {
+            return; // the node draws a simplified shape.
+        }
+
         // Draw generic part (label and background).
-        Attribute::paint(painter, nullptr, nullptr);
+        Attribute::paint(painter, option, nullptr);
 
         applyStyle(painter, mode_);
         painter->drawConvexPolygon(input_triangle_, 3);
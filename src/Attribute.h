@@ -4,25 +4,14 @@
 #include <QGraphicsItem>
 #include <QPainter>
 
+#include "Types.h"
+#include "GraphModel.h"
+#include "ThemeManager.h"
+
 namespace piper
 {
     class Link;
 
-    struct AttributeInfo
-    {
-        QString name;
-        QString dataType;
-        enum Type
-        {
-            input  = 0,
-            output = 1,
-            member = 2
-        } type;
-    };
-
-    QDataStream& operator<<(QDataStream& out, AttributeInfo const& info);
-    QDataStream& operator>>(QDataStream& in,  AttributeInfo& info);
-
     enum DisplayMode
     {
         minimize,
@@ -40,27 +29,25 @@ namespace piper
         AttributeInfo const& info() const { return info_; }
         QString const& name() const     { return info_.name; }
         QString const& dataType() const { return info_.dataType; }
+        int typeId() const              { return info_.typeId; }
         bool isInput() const  { return (info_.type == AttributeInfo::Type::input);  }
         bool isOutput() const { return (info_.type == AttributeInfo::Type::output); }
         bool isMember() const { return (info_.type == AttributeInfo::Type::member); }
 
-        void setBackgroundBrush(QBrush const& brush) { background_brush_ = brush; }
-        virtual void setColor(QColor const& color);
+        void setBackgroundBrush(QBrush const* brush) { background_brush_ = brush; }
+
+        // Use the colors of the given node mode.
+        virtual void setNodeMode(Mode mode);
         virtual void updateConnectorPosition(){}
 
 
         virtual QPointF connectorPos() const  { return QPointF{}; }
         virtual bool accept(Attribute*) const { return false; }
         void connect(Link* link);
-        void disconnect(Link* link) { links_.removeAll(link); }
+        void disconnect(Link* link);
+        QVector<Link*> const& links() const { return links_; }
         void refresh();
 
-        // Highlight compatible attributes and geyed out other.
-        void highlight();
-
-        // Revert back the highlight state.
-        void unhighlight();
-
         QVariant const& data() const { return data_; }
         virtual void setData(QVariant const& data) { data_ = data; }
 
@@ -76,7 +63,10 @@ namespace piper
         int type() const override { return Type; }
 
     protected:
-        void paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*) override;
+        void paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*) override;
+
+        // True when the item is too small on screen to display its details.
+        static bool isLowDetail(QPainter* painter, QStyleOptionGraphicsItem const* option);
 
         void applyFontStyle(QPainter* painter, DisplayMode mode);
         void applyStyle(QPainter* painter, DisplayMode mode);
@@ -85,26 +75,13 @@ namespace piper
         QVariant data_;
         DisplayMode mode_{DisplayMode::normal};
 
-        QBrush background_brush_;
-
-        QFont minimize_font_;
-        QPen minimize_font_pen_;
-        QPen minimize_pen_;
-
-        QFont normal_font_;
-        QPen normal_font_pen_;
-        QBrush normal_brush_;
-        QPen normal_pen_;
-
-        QFont highlight_font_;
-        QPen highlight_font_pen_;
-        QBrush highlight_brush_;
-        QPen highlight_pen_;
-
         QRectF bounding_rect_;
         QRectF background_rect_;
         QRectF label_rect_;
 
+        QBrush const* background_brush_; // owned by the node style
+        AttributeStyle const* style_;    // shared by the attributes of the same data type and node mode
+
         QVector<Link*> links_;
     };
 
@@ -115,13 +92,13 @@ namespace piper
         AttributeOutput(QGraphicsItem* parent, AttributeInfo const& info, QRect const& boundingRect);
         virtual ~AttributeOutput() = default;
 
-        void setColor(QColor const& color) override;
+        void setNodeMode(Mode mode) override;
         void updateConnectorPosition() override;
         void setData(QVariant const& data) override;
         QPointF connectorPos() const override { return mapToScene(connectorPos_); }
 
     protected:
-        void paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*) override;
+        void paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*) override;
         void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
         void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
         void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
@@ -144,10 +121,13 @@ namespace piper
         void setData(QVariant const& data) override;
         void updateConnectorPosition() override;
         bool accept(Attribute* attribute) const override;
+
+        // Same as accept() without the cycle check (i.e. when the caller already knows the emitter ancestors).
+        bool isConnectable(Attribute* attribute) const;
         QPointF connectorPos() const override { return mapToScene(connectorPos_); }
 
     protected:
-        void paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*) override;
+        void paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*) override;
         void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
 
         QPointF input_triangle_left_[3];
@@ -1,33 +1,86 @@
 #include "AttributeMember.h"
 #include "Scene.h"
+#include "Node.h"
+#include "Commands.h"
+#include "Profiler.h"
 
 #include <QDebug>
+#include <QFile>
 #include <QLineEdit>
+#include <QPointer>
 #include <QSpinBox>
+#include <QStyleOptionGraphicsItem>
+
+#include <limits>
 
 namespace piper
 {
-    MemberForm::MemberForm(QGraphicsItem* parent, QVariant& data, QRectF const& boundingRect, QBrush const& brush)
-        : QGraphicsProxyWidget(parent)
-        , data_{data}
+    namespace
+    {
+        // The editor currently opened (if any) and the form it belongs to.
+        QPointer<QGraphicsProxyWidget> editor;
+        MemberForm* editedForm = nullptr;
+
+        QString const& memberStyleSheet()
+        {
+            static QString const styleSheet = []()
+            {
+                QFile file(":/style.qss");
+                file.open(QFile::ReadOnly);
+                return QString(QLatin1String(file.readAll()));
+            }();
+            return styleSheet;
+        }
+    }
+
+
+    MemberForm::MemberForm(AttributeMember* member, QRectF const& boundingRect, QBrush const& brush)
+        : QGraphicsItem(member)
+        , member_{member}
         , bounding_rect_{boundingRect}
         , brush_{brush}
     {
     }
 
+    MemberForm::~MemberForm()
+    {
+        if (editedForm == this)
+        {
+            closeEditor();
+        }
+    }
+
     void MemberForm::updateFormWidth(qreal width)
     {
+        prepareGeometryChange();
         bounding_rect_.setWidth(width);
-        widget()->resize(static_cast<int>(width), static_cast<int>(bounding_rect_.height()));
+        if (editedForm == this)
+        {
+            editor->widget()->resize(bounding_rect_.size().toSize());
+        }
     }
 
-    void MemberForm::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget* widget)
+    void MemberForm::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget*)
     {
+        ProfileScope profile{"MemberForm::paint"};
+        if (option->levelOfDetailFromTransform(painter->worldTransform()) < lowDetailLevel)
+        {
+            return; // the node draws a simplified shape.
+        }
+
         painter->setPen(Qt::NoPen);
         painter->setBrush(brush_);
         painter->drawRoundedRect(bounding_rect_, 8, 8);
 
-        QGraphicsProxyWidget::paint(painter, option, widget);
+        if (editedForm == this)
+        {
+            return; // the editor displays the value.
+        }
+
+        painter->setFont(member_->font());
+        painter->setPen(Qt::black);
+        painter->drawText(bounding_rect_.adjusted(4, 0, -4, 0), Qt::AlignLeft | Qt::AlignVCenter,
+                          member_->data().toString());
     }
 
     void MemberForm::mousePressEvent(QGraphicsSceneMouseEvent* event)
@@ -39,129 +92,164 @@ namespace piper
         {
             item->setSelected(false);
         }
-    }
 
-    void MemberForm::onDataUpdated(QVariant const& data)
-    {
-        data_                   = data;
-        int width               = widget()->fontMetrics().boundingRect(data.toString()).width();
-        AttributeMember* member = qgraphicsitem_cast<AttributeMember*>(parentItem());
-        member->setFormBaseWidth(static_cast<qreal>(width));
+        edit();
     }
 
-
-    AttributeMember::AttributeMember(QGraphicsItem* parent, AttributeInfo const& info, const QRect& boundingRect)
-        : Attribute(parent, info, boundingRect)
+    void MemberForm::edit()
     {
-        // Construct the form (area, background color, widget, widgets options etc).
-        QRectF formRect{0, 0, bounding_rect_.width(), bounding_rect_.height() - 10};
-        QBrush brush{{180, 180, 180, 255}, Qt::SolidPattern};
-        form_ = new MemberForm(this, data_, formRect, brush);
-        baseWidth_ = 0;
+        closeEditor();
 
-        QWidget* widget = createWidget();
-        if (widget != nullptr)
+        QWidget* widget = createEditor();
+        if (widget == nullptr)
         {
-            widget->setFont(normal_font_);
-            widget->resize(static_cast<int>(formRect.width()), static_cast<int>(formRect.height()));
-
-            QFile File(":/style.qss");
-            File.open(QFile::ReadOnly);
-            QString StyleSheet = QLatin1String(File.readAll());
-            widget->setStyleSheet(StyleSheet);
-            form_->setWidget(widget);
+            return;
         }
-        form_->setPos(boundingRect.right() - formRect.width(), label_rect_.top() + 5);
+        widget->setFont(member_->font());
+        widget->setStyleSheet(memberStyleSheet());
+        widget->resize(bounding_rect_.size().toSize());
+
+        editor = new QGraphicsProxyWidget(this);
+        editor->setWidget(widget);
+        editedForm = this;
+        editor->setFocus();
+        widget->setFocus();
+        update();
     }
 
-    void AttributeMember::setFormBaseWidth(qreal width)
+    void MemberForm::closeEditor()
     {
-        baseWidth_ = width;
+        if (editor.isNull())
+        {
+            editedForm = nullptr;
+            return;
+        }
+
+        // The editor may be closed from one of its own signals: silent it and delete it later.
+        editor->widget()->disconnect();
+        editor->deleteLater();
+        editor.clear();
+
+        if (editedForm != nullptr)
+        {
+            editedForm->update();
+            editedForm = nullptr;
+        }
     }
 
-    void AttributeMember::updateRectSize(QRectF rectangle)
+    void MemberForm::commit(QVariant const& data)
     {
-        bounding_rect_   = rectangle;
-        background_rect_ = bounding_rect_;
-        form_->updateFormWidth(bounding_rect_.width() - label_rect_.width() - 20);
-        form_->setPos(bounding_rect_.right() - form_->boundingRect().width(), label_rect_.top() + 5);
+        QVariant previous = member_->data();
+        member_->setData(data);
+
+        Scene* pScene = static_cast<Scene*>(scene());
+        if ((pScene == nullptr) or (previous == member_->data()))
+        {
+            return;
+        }
+
+        Node* node = static_cast<Node*>(member_->parentItem());
+        pScene->undoStack().push(
+            new EditAttributeCommand(pScene, node->name(), member_->name(), previous, member_->data()));
     }
 
-    void AttributeMember::setData(QVariant const& data)
+    QWidget* MemberForm::createEditor()
     {
-        switch (data.type())
+        switch (member_->kind())
         {
-            //QJsonValue always returns QVariant::Double with numbers
-            //send both signals, the widget with corresponding type will receive values
-            case QVariant::Int:
-            case QVariant::Double:
+            case AttributeMember::Kind::integer:
+            {
+                QSpinBox* box = new QSpinBox();
+                box->setMaximum(std::numeric_limits<int>::max());
+                box->setMinimum(std::numeric_limits<int>::min());
+                box->setValue(member_->data().toInt());
+                box->selectAll();
+                QObject::connect(box, &QSpinBox::editingFinished, box, [this, box]()
+                {
+                    commit(box->value());
+                    closeEditor();
+                });
+                return box;
+            }
+            case AttributeMember::Kind::real:
             {
-                form_->dataUpdated(data.toInt());
-                form_->dataUpdated(data.toDouble());
-                break;
+                QDoubleSpinBox* box = new QDoubleSpinBox();
+                box->setMaximum(std::numeric_limits<double>::max());
+                box->setMinimum(-std::numeric_limits<double>::max());
+                box->setDecimals(10);
+                box->setValue(member_->data().toDouble());
+                box->selectAll();
+                QObject::connect(box, &QDoubleSpinBox::editingFinished, box, [this, box]()
+                {
+                    commit(box->value());
+                    closeEditor();
+                });
+                return box;
             }
-            case QVariant::String:
+            case AttributeMember::Kind::text:
             {
-                form_->dataUpdated(data.toString());
-                break;
+                QLineEdit* lineEdit = new QLineEdit(member_->data().toString());
+                lineEdit->selectAll();
+                QObject::connect(lineEdit, &QLineEdit::editingFinished, lineEdit, [this, lineEdit]()
+                {
+                    commit(lineEdit->text());
+                    closeEditor();
+                });
+                return lineEdit;
             }
-            default:
+            case AttributeMember::Kind::none:
             {
-                qDebug() << "Incompatible type: " << data << ". Do nothing";
+                return nullptr;
             }
         }
+        return nullptr;
     }
 
-    QWidget* AttributeMember::createWidget()
+
+    AttributeMember::AttributeMember(QGraphicsItem* parent, AttributeInfo const& info, const QRect& boundingRect)
+        : Attribute(parent, info, boundingRect)
+        , kind_{memberKind(info.dataType)}
     {
-        QStringList supportedTypes;
+        // Construct the form (area, background color). The editor widget is created when the user clicks on it.
+        QRectF formRect{0, 0, bounding_rect_.width(), bounding_rect_.height() - 10};
+        QBrush brush{{180, 180, 180, 255}, Qt::SolidPattern};
+        form_ = new MemberForm(this, formRect, brush);
+        baseWidth_ = 0;
+        data_ = defaultMemberValue(kind_);
+        form_->setPos(boundingRect.right() - formRect.width(), label_rect_.top() + 5);
+    }
 
-        supportedTypes << "int"
-                       << "integer"
-                       << "int32_t"
-                       << "int64_t";
-        if (supportedTypes.contains(dataType()))
+    void AttributeMember::setFormBaseWidth(qreal width)
+    {
+        if (baseWidth_ == width)
         {
-            QSpinBox* box = new QSpinBox();
-            data_         = box->value();
-            box->setMaximum(std::numeric_limits<int>::max());
-            box->setMinimum(std::numeric_limits<int>::min());
-            QObject::connect(box, QOverload<int>::of(&QSpinBox::valueChanged), form_, &MemberForm::onDataUpdated);
-            QObject::connect(form_, SIGNAL(dataUpdated(int)), box, SLOT(setValue(int)));
-            return box;
+            return;
         }
 
-        supportedTypes.clear();
-        supportedTypes << "float"
-                       << "double"
-                       << "real"
-                       << "float32_t"
-                       << "float64_t";
-        if (supportedTypes.contains(dataType()))
-        {
-            QDoubleSpinBox* box = new QDoubleSpinBox();
-            data_               = box->value();
-            box->setMaximum(std::numeric_limits<double>::max());
-            box->setMinimum(-std::numeric_limits<double>::max());
-            box->setDecimals(10);
-            QObject::connect(
-                box, QOverload<double>::of(&QDoubleSpinBox::valueChanged), form_, &MemberForm::onDataUpdated);
-            QObject::connect(form_, SIGNAL(dataUpdated(double)), box, SLOT(setValue(double)));
-            return box;
-        }
+        baseWidth_ = width;
+        static_cast<Node*>(parentItem())->invalidateLayout();
+    }
 
-        supportedTypes.clear();
-        supportedTypes << "string";
-        if (supportedTypes.contains(dataType()))
+    void AttributeMember::updateRectSize(QRectF rectangle)
+    {
+        bounding_rect_   = rectangle;
+        background_rect_ = bounding_rect_;
+        form_->updateFormWidth(bounding_rect_.width() - label_rect_.width() - 20);
+        form_->setPos(bounding_rect_.right() - form_->boundingRect().width(), label_rect_.top() + 5);
+    }
+
+    void AttributeMember::setData(QVariant const& data)
+    {
+        QVariant value = toMemberValue(kind_, data);
+        if (not value.isValid())
         {
-            QLineEdit* lineEdit = new QLineEdit();
-            data_               = lineEdit->text();
-            lineEdit->setFont(normal_font_);
-            QObject::connect(lineEdit, &QLineEdit::textChanged, form_, &MemberForm::onDataUpdated);
-            QObject::connect(form_, SIGNAL(dataUpdated(QString const&)), lineEdit, SLOT(setText(QString const&)));
-            return lineEdit;
+            qDebug() << "Incompatible type: " << data << ". Do nothing";
+            return;
         }
 
-        return nullptr;
+        data_ = value;
+        int width = QFontMetrics(style_->normal.font).boundingRect(data_.toString()).width();
+        setFormBaseWidth(static_cast<qreal>(width));
+        form_->update();
     }
 }
@@ -8,32 +8,34 @@
 
 namespace piper
 {
-    /// \brief Handle the member form (draw the backround and own the dedicated QWidget)
-    class MemberForm : public QGraphicsProxyWidget
-    {
-        Q_OBJECT
+    class AttributeMember;
 
+    /// \brief Handle the member form (draw the background and the value).
+    /// The value is edited with a widget that is created on demand: only one editor exists at a time.
+    class MemberForm : public QGraphicsItem
+    {
     public:
-        MemberForm(QGraphicsItem* parent, QVariant& data, QRectF const& boundingRect, QBrush const& brush);
-        virtual ~MemberForm() = default;
+        MemberForm(AttributeMember* member, QRectF const& boundingRect, QBrush const& brush);
+        virtual ~MemberForm();
 
         QRectF boundingRect() const override { return bounding_rect_; }
-        void updateFormWidth(qreal data);
+        void updateFormWidth(qreal width);
 
-    signals:
-        void dataUpdated(int);
-        void dataUpdated(double);
-        void dataUpdated(QString const&);
+        // Open the shared editor on this form.
+        void edit();
 
-    public slots:
-        void onDataUpdated(QVariant const& data);
+        // Apply a value entered by the user (the edit is recorded in the undo stack).
+        void commit(QVariant const& data);
 
     protected:
         void paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*) override;
         void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
 
     private:
-        QVariant& data_; // reference on attribute's data
+        QWidget* createEditor();
+        static void closeEditor();
+
+        AttributeMember* member_;
         QRectF bounding_rect_;
         QBrush brush_;
     };
@@ -42,18 +44,23 @@ namespace piper
     class AttributeMember : public Attribute
     {
     public:
+        // Kind of value held by the member, deduced once from its data type.
+        using Kind = MemberKind;
+
         AttributeMember(QGraphicsItem* parent, AttributeInfo const& info, QRect const& boundingRect);
         virtual ~AttributeMember() = default;
 
-        // Set the data by working closely with the MemberForm class.
+        Kind kind() const { return kind_; }
+        QFont const& font() const { return style_->normal.font; }
+
+        // Set the data (converted to the member kind) and update the form.
         void setData(QVariant const& data) override;
         void updateRectSize(QRectF rectangle) override;
         void setFormBaseWidth(qreal width);
         qreal getFormBaseWidth() const override { return baseWidth_; };
 
     private:
-        QWidget* createWidget();
-
+        Kind kind_;
         MemberForm* form_;
         qreal baseWidth_;
     };
@@ -0,0 +1,496 @@
+#include "CborExport.h"
+#include "MappedFile.h"
+
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QDebug>
+
+namespace piper
+{
+    bool CborExport::init(QString const& filename)
+    {
+        file_.setFileName(filename);
+        if (not file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qDebug() << "Error while opening" << file_.fileName();
+            return false;
+        }
+
+        names_.clear();
+        writer_.startMap();
+        writer_.append(QLatin1String("piper-cbor"));
+        writer_.append(version);
+        writer_.append(QLatin1String("pipelines"));
+        writer_.startArray();
+        return true;
+    }
+
+
+    bool CborExport::finalize(QString const&)
+    {
+        if (not file_.isOpen())
+        {
+            return false;
+        }
+
+        writer_.endArray();
+        writer_.endMap();
+        file_.close(); // flush: a write error is kept by the file
+        return file_.error() == QFileDevice::NoError;
+    }
+
+
+    void CborExport::startPipeline(QString const& pipelineName)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        writer_.startMap();
+        writer_.append(QLatin1String("name"));
+        writeName(pipelineName);
+        section_.clear();
+        default_mode_.clear();
+    }
+
+
+    void CborExport::endPipeline(QString const&)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        enterSection({});
+        if (not default_mode_.isEmpty())
+        {
+            writer_.append(QLatin1String("default"));
+            writeName(default_mode_);
+        }
+        writer_.endMap();
+    }
+
+
+    void CborExport::enterSection(QString const& section)
+    {
+        if (section == section_)
+        {
+            return;
+        }
+
+        if (not section_.isEmpty())
+        {
+            writer_.endArray();
+        }
+
+        section_ = section;
+        if (not section_.isEmpty())
+        {
+            writer_.append(section_);
+            writer_.startArray();
+        }
+    }
+
+
+    void CborExport::writeName(QString const& name)
+    {
+        auto it = names_.constFind(name);
+        if (it != names_.constEnd())
+        {
+            writer_.append(it.value());
+            return;
+        }
+
+        names_.insert(name, static_cast<quint64>(names_.size()));
+        writer_.append(name);
+    }
+
+
+    void CborExport::writeStages(QVector<QString> const& stages)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        enterSection("stages");
+        for (auto const& stage : stages)
+        {
+            writeName(stage);
+        }
+    }
+
+
+    void CborExport::writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        enterSection("nodes");
+        writer_.startArray(4);
+        writeName(type);
+        writeName(name);
+        writeName(stage);
+
+        QHash<QString, QVariant> members = attributes;
+        if (members.remove("type"))  { qWarning() << "type is a reserved attribute. Skipping.";  }
+        if (members.remove("stage")) { qWarning() << "stage is a reserved attribute. Skipping."; }
+
+        writer_.startMap(members.size());
+        for (auto it = members.constBegin(); it != members.constEnd(); ++it)
+        {
+            writeName(it.key());
+            QCborValue::fromVariant(it.value()).toCbor(writer_);
+        }
+        writer_.endMap();
+        writer_.endArray();
+    }
+
+
+    void CborExport::writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                               QString const& type, QString const& conversion)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        enterSection("links");
+        writer_.startArray(conversion.isEmpty() ? 5 : 6);
+        writeName(from);
+        writeName(output);
+        writeName(to);
+        writeName(input);
+        writeName(type);
+        if (not conversion.isEmpty())
+        {
+            writeName(conversion);
+        }
+        writer_.endArray();
+    }
+
+
+    void CborExport::writeMode(QString const& name, QHash<QString, Mode> const& config)
+    {
+        if (not file_.isOpen())
+        {
+            return;
+        }
+
+        enterSection("modes");
+        quint64 configured = 0;
+        for (auto it = config.constBegin(); it != config.constEnd(); ++it)
+        {
+            if (it.value() != Mode::enable)
+            {
+                ++configured;
+            }
+        }
+
+        writer_.startArray(2);
+        writeName(name);
+        writer_.startMap(configured);
+        for (auto it = config.constBegin(); it != config.constEnd(); ++it)
+        {
+            if (it.value() != Mode::enable)
+            {
+                writeName(it.key());
+                writer_.append(static_cast<int>(it.value()));
+            }
+        }
+        writer_.endMap();
+        writer_.endArray();
+    }
+
+
+    void CborExport::writeDefaultMode(QString const& name)
+    {
+        default_mode_ = name; // written with the pipeline end: modes may come after.
+    }
+
+
+    namespace
+    {
+        // Read the CborExport layout. On a malformed document, the reader error is set (or failed_ for layout errors).
+        class CborDecoder
+        {
+        public:
+            CborDecoder(QByteArray const& data, QStringList& errors)
+                : reader_{data}
+                , errors_{errors}
+            {
+            }
+
+            bool read(Project& project)
+            {
+                project.clear();
+                if (not enter(true))
+                {
+                    return false;
+                }
+
+                bool valid = false;
+                while (reader_.hasNext() and not failed())
+                {
+                    QString const key = readKey();
+                    if (key == "piper-cbor")
+                    {
+                        if ((not reader_.isInteger()) or (reader_.toInteger() > CborExport::version))
+                        {
+                            errors_.append("Unsupported CBOR file version");
+                            return false;
+                        }
+                        reader_.next();
+                        valid = true;
+                    }
+                    else if ((key == "pipelines") and enter(false))
+                    {
+                        while (reader_.hasNext() and not failed())
+                        {
+                            project.append(readPipeline());
+                        }
+                        reader_.leaveContainer();
+                    }
+                    else
+                    {
+                        reader_.next(); // unknown key: skip its value
+                    }
+                }
+
+                if (not valid)
+                {
+                    errors_.append("Not a Piper CBOR file");
+                    return false;
+                }
+                if (failed())
+                {
+                    errors_.append("Malformed CBOR file: " + reader_.lastError().toString());
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            bool failed() const
+            {
+                return failed_ or (reader_.lastError() != QCborError::NoError);
+            }
+
+            // Enter a map (or an array).
+            bool enter(bool map)
+            {
+                if ((map and not reader_.isMap()) or ((not map) and not reader_.isArray()))
+                {
+                    failed_ = true;
+                    return false;
+                }
+                return reader_.enterContainer();
+            }
+
+            QString readText()
+            {
+                QString text;
+                auto chunk = reader_.readString();
+                while (chunk.status == QCborStreamReader::Ok)
+                {
+                    text += chunk.data;
+                    chunk = reader_.readString();
+                }
+                if (chunk.status == QCborStreamReader::Error)
+                {
+                    failed_ = true;
+                }
+                return text;
+            }
+
+            QString readKey()
+            {
+                if (not reader_.isString())
+                {
+                    reader_.next();
+                    return {};
+                }
+                return readText();
+            }
+
+            // Interned string: text the first time, then its index.
+            QString readName()
+            {
+                if (reader_.isString())
+                {
+                    QString const name = readText();
+                    names_.append(name);
+                    return name;
+                }
+
+                if (reader_.isUnsignedInteger())
+                {
+                    quint64 const index = reader_.toUnsignedInteger();
+                    reader_.next();
+                    if (index < static_cast<quint64>(names_.size()))
+                    {
+                        return names_.at(static_cast<int>(index));
+                    }
+                }
+
+                failed_ = true;
+                return {};
+            }
+
+            Pipeline readPipeline()
+            {
+                Pipeline pipeline;
+                if (not enter(true))
+                {
+                    return pipeline;
+                }
+
+                Graph& graph = pipeline.graph;
+                QVector<GraphMode> modes;
+                QString defaultMode;
+                while (reader_.hasNext() and not failed())
+                {
+                    QString const key = readKey();
+                    if (key == "name")
+                    {
+                        pipeline.name = readName();
+                    }
+                    else if ((key == "stages") and enter(false))
+                    {
+                        while (reader_.hasNext() and not failed())
+                        {
+                            graph.addStage({readName(), generateRandomColor()});
+                        }
+                        reader_.leaveContainer();
+                    }
+                    else if ((key == "nodes") and enter(false))
+                    {
+                        while (reader_.hasNext() and not failed())
+                        {
+                            readNode(pipeline);
+                        }
+                        reader_.leaveContainer();
+                    }
+                    else if ((key == "links") and enter(false))
+                    {
+                        while (reader_.hasNext() and not failed() and enter(false))
+                        {
+                            LinkData link;
+                            link.from   = readName();
+                            link.output = readName();
+                            link.to     = readName();
+                            link.input  = readName();
+                            // Data type and conversion are deduced from the attributes, but they are interned names:
+                            // they shall be read to keep the string table in sync with the writer.
+                            while (reader_.hasNext() and not failed())
+                            {
+                                readName();
+                            }
+                            reader_.leaveContainer();
+                            graph.addLink(link);
+                        }
+                        reader_.leaveContainer();
+                    }
+                    else if ((key == "modes") and enter(false))
+                    {
+                        while (reader_.hasNext() and not failed() and enter(false))
+                        {
+                            GraphMode mode;
+                            mode.name = readName();
+                            if (enter(true))
+                            {
+                                while (reader_.hasNext() and not failed())
+                                {
+                                    QString const node = readName();
+                                    if (not reader_.isInteger())
+                                    {
+                                        failed_ = true;
+                                        break;
+                                    }
+                                    mode.nodes.insert(node, static_cast<Mode>(reader_.toInteger()));
+                                    reader_.next();
+                                }
+                                reader_.leaveContainer();
+                            }
+                            reader_.leaveContainer();
+                            modes.append(mode);
+                        }
+                        reader_.leaveContainer();
+                    }
+                    else if (key == "default")
+                    {
+                        defaultMode = readName();
+                    }
+                    else
+                    {
+                        reader_.next();
+                    }
+                }
+                reader_.leaveContainer();
+
+                for (auto& mode : modes)
+                {
+                    mode.isDefault = (mode.name == defaultMode);
+                    graph.addMode(mode);
+                }
+                graph.placeNodesByStage({0, 0});
+                return pipeline;
+            }
+
+            void readNode(Pipeline& pipeline)
+            {
+                if (not enter(false))
+                {
+                    return;
+                }
+
+                QString const type  = readName();
+                QString const name  = readName();
+                QString const stage = readName();
+                GraphNode* node = pipeline.graph.createNode(type, name, stage);
+                if (node == nullptr)
+                {
+                    errors_.append(pipeline.name + ": Cannot create node " + name + ": type " + type + " is unknown.");
+                }
+
+                if (enter(true))
+                {
+                    while (reader_.hasNext() and not failed())
+                    {
+                        QString const attribute = readName();
+                        QVariant const value = QCborValue::fromCbor(reader_).toVariant();
+                        if ((node != nullptr) and (not node->setData(attribute, value)))
+                        {
+                            errors_.append(pipeline.name + ": Attribute " + attribute + " not found: version mismatch ?");
+                        }
+                    }
+                    reader_.leaveContainer();
+                }
+                reader_.leaveContainer();
+            }
+
+            QCborStreamReader reader_;
+            QStringList& errors_;
+            QStringList names_; // string table, in order of appearance
+            bool failed_{false};
+        };
+    }
+
+
+    bool readCborFile(QString const& filename, Project& project, QStringList& errors)
+    {
+        MappedFile file;
+        QString error;
+        if (not file.open(filename, error))
+        {
+            errors.append(error);
+            return false;
+        }
+
+        CborDecoder decoder(file.data(), errors);
+        return decoder.read(project);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef PIPER_CBOR_EXPORT_H
+#define PIPER_CBOR_EXPORT_H
+
+#include "ExportBackend.h"
+#include "Project.h"
+
+#include <QCborStreamWriter>
+#include <QFile>
+#include <QHash>
+
+namespace piper
+{
+    /// \brief Binary export (CBOR, RFC 7049) streamed to the file.
+    ///
+    /// Layout (containers of unknown size are indefinite):
+    ///   {"piper-cbor": version, "pipelines": [pipeline...]}
+    ///   pipeline: {"name": s, "stages": [s...], "nodes": [node...], "links": [link...], "modes": [mode...],
+    ///              "default": s}
+    ///   node:     [type s, name s, stage s, {attribute s: value}]
+    ///   link:     [from s, output s, to s, input s, data type s (, conversion s)]
+    ///   mode:     [name s, {node s: Mode}]   (enabled nodes are omitted)
+    /// Names (s) are interned: the first occurrence of a string is written as text and the next ones as its index
+    /// in the order of appearance (one table for the file). Attribute values are plain CBOR values.
+    class CborExport : public ExportBackend
+    {
+    public:
+        static constexpr int version = 1;
+
+        CborExport() = default;
+        virtual ~CborExport() = default;
+
+        // Open the file.
+        bool init(QString const& filename) override;
+
+        // Close the document and the file.
+        bool finalize(QString const& filename) override;
+
+        void startPipeline(QString const& pipelineName) override;
+        void endPipeline(QString const& pipelineName) override;
+
+        void writeStages(QVector<QString> const& stages) override;
+        void writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes) override;
+        void writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                       QString const& type, QString const& conversion) override;
+        void writeMode(QString const& name, QHash<QString, Mode> const& config) override;
+        void writeDefaultMode(QString const& name) override;
+
+    private:
+        // Close the current section array and open the given one (if it is not already the current one).
+        void enterSection(QString const& section);
+
+        // Write an interned string.
+        void writeName(QString const& name);
+
+        QFile file_;
+        QCborStreamWriter writer_{&file_};
+        QHash<QString, quint64> names_;     // string -> index in the table
+        QString section_;                   // current section of the pipeline (empty: none)
+        QString default_mode_;
+    };
+
+    // Read a file written by CborExport. Nodes are placed by stage. Problems are appended to errors.
+    bool readCborFile(QString const& filename, Project& project, QStringList& errors);
+}
+
+#endif
@@ -0,0 +1,334 @@
+#include "Commands.h"
+#include "Scene.h"
+#include "Node.h"
+
+#include <QDataStream>
+
+namespace piper
+{
+    namespace
+    {
+        qint64 stringCost(QString const& string)
+        {
+            return string.size() * static_cast<qint64>(sizeof(QChar));
+        }
+
+        qint64 linkCost(LinkData const& link)
+        {
+            return sizeof(LinkData) + stringCost(link.from) + stringCost(link.output)
+                                    + stringCost(link.to)   + stringCost(link.input);
+        }
+    }
+
+
+    ItemsCommand::ItemsCommand(Scene* scene, QList<Node*> const& nodes, QVector<LinkData> const& links)
+        : scene_{scene}
+        , links_{links}
+    {
+        for (auto const& node : nodes)
+        {
+            names_ << node->name();
+        }
+    }
+
+
+    qint64 ItemsCommand::cost() const
+    {
+        qint64 bytes = sizeof(*this) + nodes_.size();
+        for (auto const& name : names_)
+        {
+            bytes += stringCost(name);
+        }
+        for (auto const& link : links_)
+        {
+            bytes += linkCost(link);
+        }
+        return bytes;
+    }
+
+
+    void ItemsCommand::compress()
+    {
+        if (compressed_ or nodes_.isEmpty())
+        {
+            return;
+        }
+
+        nodes_ = qCompress(nodes_);
+        compressed_ = true;
+    }
+
+
+    void ItemsCommand::insert()
+    {
+        if (compressed_)
+        {
+            nodes_ = qUncompress(nodes_);
+            compressed_ = false;
+        }
+
+        QDataStream stream(nodes_);
+        int nodeCount = 0;
+        stream >> nodeCount;
+
+        bool const bulk = scene_->isBulkUpdateWorth(nodeCount + links_.size());
+        if (bulk)
+        {
+            scene_->beginBulkUpdate();
+        }
+        for (int i = 0; i < nodeCount; ++i)
+        {
+            Node* node = new Node();
+            QHash<QString, QVariant> modes;
+            stream >> *node >> modes;
+            scene_->addNode(node);
+            scene_->applyStageColor(node);
+            scene_->restoreNodeModes(node->name(), modes);
+        }
+
+        for (auto const& link : links_)
+        {
+            scene_->connect(link.from, link.output, link.to, link.input);
+        }
+        if (bulk)
+        {
+            scene_->endBulkUpdate();
+        }
+    }
+
+
+    void ItemsCommand::erase()
+    {
+        QList<Node*> nodes;
+        for (auto const& name : names_)
+        {
+            Node* node = scene_->findNode(name);
+            if (node != nullptr)
+            {
+                nodes << node;
+            }
+        }
+
+        // Save the current state of the nodes: it may have changed since the command creation (i.e. stage edition).
+        nodes_.clear();
+        compressed_ = false;
+        QDataStream stream(&nodes_, QIODevice::WriteOnly);
+        stream << nodes.size();
+        for (auto const& node : nodes)
+        {
+            stream << *node << scene_->nodeModes(node->name());
+        }
+
+        for (auto const& link : links_)
+        {
+            delete scene_->findLink(link);
+        }
+
+        for (auto& node : nodes)
+        {
+            delete node;
+        }
+    }
+
+
+    AddItemsCommand::AddItemsCommand(Scene* scene, QList<Node*> const& nodes, QVector<LinkData> const& links)
+        : ItemsCommand(scene, nodes, links)
+    {
+    }
+
+
+    RemoveItemsCommand::RemoveItemsCommand(Scene* scene, QList<Node*> const& nodes, QList<Link*> const& links)
+        : ItemsCommand(scene, nodes, {})
+    {
+        // Collect the removed links: selected ones and the ones connected to a removed node.
+        QList<Link*> removed;
+        auto collect = [&removed](Link* link)
+        {
+            if (link->isConnected() and not removed.contains(link))
+            {
+                removed << link;
+            }
+        };
+
+        for (auto const& link : links)
+        {
+            collect(link);
+        }
+
+        for (auto const& node : nodes)
+        {
+            for (auto const& attribute : node->attributes())
+            {
+                for (auto const& link : attribute->links())
+                {
+                    collect(link);
+                }
+            }
+        }
+
+        for (auto const& link : removed)
+        {
+            links_.append(link->endpoints());
+        }
+    }
+
+
+    MoveNodesCommand::MoveNodesCommand(Scene* scene, QHash<QString, QPointF> const& from,
+                                       QHash<QString, QPointF> const& to, bool nudge)
+        : scene_{scene}
+        , from_{from}
+        , to_{to}
+        , nudge_{nudge}
+    {
+    }
+
+
+    bool MoveNodesCommand::mergeWith(UndoCommand const* other)
+    {
+        MoveNodesCommand const* move = static_cast<MoveNodesCommand const*>(other);
+        if (move->to_.size() != to_.size())
+        {
+            return false;
+        }
+
+        for (auto it = move->to_.constBegin(); it != move->to_.constEnd(); ++it)
+        {
+            if (not to_.contains(it.key()))
+            {
+                return false;
+            }
+        }
+
+        to_ = move->to_;
+        return true;
+    }
+
+
+    qint64 MoveNodesCommand::cost() const
+    {
+        qint64 bytes = sizeof(*this);
+        for (auto it = from_.constBegin(); it != from_.constEnd(); ++it)
+        {
+            bytes += 2 * (stringCost(it.key()) + sizeof(QPointF));
+        }
+        return bytes;
+    }
+
+
+    void MoveNodesCommand::apply(QHash<QString, QPointF> const& positions)
+    {
+        for (auto it = positions.constBegin(); it != positions.constEnd(); ++it)
+        {
+            Node* node = scene_->findNode(it.key());
+            if (node != nullptr)
+            {
+                node->setPos(it.value());
+            }
+        }
+    }
+
+
+    ConnectCommand::ConnectCommand(Scene* scene, LinkData const& link, LinkData const& previous)
+        : scene_{scene}
+        , link_{link}
+        , previous_{previous}
+    {
+    }
+
+
+    qint64 ConnectCommand::cost() const
+    {
+        return sizeof(*this) + linkCost(link_) + linkCost(previous_);
+    }
+
+
+    void ConnectCommand::undo()
+    {
+        delete scene_->findLink(link_);
+        if (not previous_.from.isEmpty())
+        {
+            scene_->connect(previous_.from, previous_.output, previous_.to, previous_.input);
+        }
+    }
+
+
+    void ConnectCommand::redo()
+    {
+        if (not previous_.from.isEmpty())
+        {
+            delete scene_->findLink(previous_);
+        }
+        scene_->connect(link_.from, link_.output, link_.to, link_.input);
+    }
+
+
+    RenameNodeCommand::RenameNodeCommand(Scene* scene, QString const& previous, QString const& name)
+        : scene_{scene}
+        , previous_{previous}
+        , name_{name}
+    {
+    }
+
+
+    qint64 RenameNodeCommand::cost() const
+    {
+        return sizeof(*this) + stringCost(previous_) + stringCost(name_);
+    }
+
+
+    void RenameNodeCommand::apply(QString const& from, QString const& to)
+    {
+        Node* node = scene_->findNode(from);
+        if (node != nullptr)
+        {
+            node->setName(to);
+        }
+    }
+
+
+    EditAttributeCommand::EditAttributeCommand(Scene* scene, QString const& node, QString const& attribute,
+                                               QVariant const& previous, QVariant const& next)
+        : scene_{scene}
+        , node_{node}
+        , attribute_{attribute}
+        , previous_{previous}
+        , next_{next}
+    {
+    }
+
+
+    bool EditAttributeCommand::mergeWith(UndoCommand const* other)
+    {
+        EditAttributeCommand const* edit = static_cast<EditAttributeCommand const*>(other);
+        if ((edit->node_ != node_) or (edit->attribute_ != attribute_))
+        {
+            return false;
+        }
+
+        next_ = edit->next_;
+        return true;
+    }
+
+
+    qint64 EditAttributeCommand::cost() const
+    {
+        return sizeof(*this) + stringCost(node_) + stringCost(attribute_)
+                             + stringCost(previous_.toString()) + stringCost(next_.toString());
+    }
+
+
+    void EditAttributeCommand::apply(QVariant const& data)
+    {
+        Node* node = scene_->findNode(node_);
+        if (node == nullptr)
+        {
+            return;
+        }
+
+        Attribute* attribute = node->attribute(attribute_);
+        if (attribute != nullptr)
+        {
+            attribute->setData(data);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef PIPER_COMMANDS_H
+#define PIPER_COMMANDS_H
+
+#include "UndoStack.h"
+#include "Link.h"
+
+#include <QHash>
+#include <QPointF>
+#include <QStringList>
+
+namespace piper
+{
+    class Scene;
+    class Node;
+
+    /// \brief Base of the commands that insert or erase nodes (and their links).
+    /// Items are referenced by name: the command only stores the data of the nodes it touches.
+    class ItemsCommand : public UndoCommand
+    {
+    public:
+        ItemsCommand(Scene* scene, QList<Node*> const& nodes, QVector<LinkData> const& links);
+        virtual ~ItemsCommand() = default;
+
+        qint64 cost() const override;
+        void compress() override;
+
+    protected:
+        // Recreate the nodes from the saved data then reconnect the links.
+        void insert();
+
+        // Save the nodes data then destroy the links and the nodes.
+        void erase();
+
+        Scene* scene_;
+        QStringList names_;
+        QVector<LinkData> links_;
+
+        QByteArray nodes_;          // serialized nodes with their modes (mode name -> node mode), filled on erase()
+        bool compressed_{false};    // nodes_ is packed with qCompress()
+    };
+
+
+    class AddItemsCommand : public ItemsCommand
+    {
+    public:
+        AddItemsCommand(Scene* scene, QList<Node*> const& nodes, QVector<LinkData> const& links = {});
+
+        void undo() override { erase();  }
+        void redo() override { insert(); }
+    };
+
+
+    class RemoveItemsCommand : public ItemsCommand
+    {
+    public:
+        // Links connected to the removed nodes are removed too.
+        RemoveItemsCommand(Scene* scene, QList<Node*> const& nodes, QList<Link*> const& links);
+
+        void undo() override { insert(); }
+        void redo() override { erase();  }
+    };
+
+
+    class MoveNodesCommand : public UndoCommand
+    {
+    public:
+        // A nudge (keyboard move) can be merged with the next nudge of the same nodes.
+        MoveNodesCommand(Scene* scene, QHash<QString, QPointF> const& from, QHash<QString, QPointF> const& to,
+                         bool nudge = false);
+
+        void undo() override { apply(from_); }
+        void redo() override { apply(to_);   }
+
+        int id() const override { return nudge_ ? 1 : -1; }
+        bool mergeWith(UndoCommand const* other) override;
+        qint64 cost() const override;
+
+    private:
+        void apply(QHash<QString, QPointF> const& positions);
+
+        Scene* scene_;
+        QHash<QString, QPointF> from_;
+        QHash<QString, QPointF> to_;
+        bool nudge_;
+    };
+
+
+    class ConnectCommand : public UndoCommand
+    {
+    public:
+        // When previous has a valid source, the edit moved the link end from previous to link.
+        ConnectCommand(Scene* scene, LinkData const& link, LinkData const& previous = {});
+
+        void undo() override;
+        void redo() override;
+        qint64 cost() const override;
+
+    private:
+        Scene* scene_;
+        LinkData link_;
+        LinkData previous_;
+    };
+
+
+    class RenameNodeCommand : public UndoCommand
+    {
+    public:
+        RenameNodeCommand(Scene* scene, QString const& previous, QString const& name);
+
+        void undo() override { apply(name_, previous_); }
+        void redo() override { apply(previous_, name_); }
+        qint64 cost() const override;
+
+    private:
+        void apply(QString const& from, QString const& to);
+
+        Scene* scene_;
+        QString previous_;
+        QString name_;
+    };
+
+
+    class EditAttributeCommand : public UndoCommand
+    {
+    public:
+        EditAttributeCommand(Scene* scene, QString const& node, QString const& attribute,
+                             QVariant const& previous, QVariant const& next);
+
+        void undo() override { apply(previous_); }
+        void redo() override { apply(next_);     }
+
+        int id() const override { return 2; }
+        bool mergeWith(UndoCommand const* other) override;
+        qint64 cost() const override;
+
+    private:
+        void apply(QVariant const& data);
+
+        Scene* scene_;
+        QString node_;
+        QString attribute_;
+        QVariant previous_;
+        QVariant next_;
+    };
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "CreatorPopup.h"
 #include "NodeCreator.h"
 #include "Scene.h"
+#include "Node.h"
+#include "Commands.h"
 
 #include <QAbstractItemView>
 #include <QPointF>
@@ -85,6 +87,7 @@ namespace piper
         if (node != nullptr)
         {
             piperScene->addNode(node);
+            piperScene->undoStack().push(new AddItemsCommand(piperScene, {node}));
         }
     }
 
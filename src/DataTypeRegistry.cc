@@ -0,0 +1,170 @@
+#include "DataTypeRegistry.h"
+
+#include <algorithm>
+
+namespace piper
+{
+    constexpr int DataTypeRegistry::invalidId;
+
+
+    DataTypeRegistry& DataTypeRegistry::instance()
+    {
+        static DataTypeRegistry registry;
+        return registry;
+    }
+
+
+    int DataTypeRegistry::intern(QString const& dataType)
+    {
+        {
+            QReadLocker locker(&lock_);
+            auto it = ids_.constFind(dataType);
+            if (it != ids_.constEnd())
+            {
+                return it.value();
+            }
+        }
+
+        QWriteLocker locker(&lock_);
+        auto it = ids_.constFind(dataType); // another thread may have registered it meanwhile.
+        if (it != ids_.constEnd())
+        {
+            return it.value();
+        }
+
+        int const newId = names_.size();
+        names_.append(dataType);
+        ids_.insert(dataType, newId);
+        conversions_.append({});
+        if (newId >= matrix_size_)
+        {
+            reserveMatrix(std::max(16, matrix_size_ * 2));
+        }
+        invalidateSnapshot();
+        return newId;
+    }
+
+
+    int DataTypeRegistry::id(QString const& dataType) const
+    {
+        QReadLocker locker(&lock_);
+        return ids_.value(dataType, invalidId);
+    }
+
+
+    QString DataTypeRegistry::name(int id) const
+    {
+        QReadLocker locker(&lock_);
+        if ((id < 0) or (id >= names_.size()))
+        {
+            return {};
+        }
+        return names_.at(id);
+    }
+
+
+    int DataTypeRegistry::count() const
+    {
+        QReadLocker locker(&lock_);
+        return names_.size();
+    }
+
+
+    void DataTypeRegistry::addConversion(int from, int to, int cost, QString const& kernel)
+    {
+        QWriteLocker locker(&lock_);
+        if ((from < 0) or (to < 0) or (from >= names_.size()) or (to >= names_.size()) or (from == to))
+        {
+            return;
+        }
+
+        int& entry = costs_[from * matrix_size_ + to];
+        if (entry < 0)
+        {
+            conversions_[from].append(to);
+        }
+        entry = cost;
+        kernels_.insert(qMakePair(from, to), kernel);
+        invalidateSnapshot();
+    }
+
+
+    int DataTypeRegistry::conversionCost(int from, int to) const
+    {
+        Snapshot const* registry = snapshot();
+        if ((from < 0) or (to < 0) or (from >= registry->types) or (to >= registry->types))
+        {
+            return -1; // unregistered types are not compatible, even with themselves
+        }
+        if (from == to)
+        {
+            return 0;
+        }
+        return registry->costs.at(from * registry->matrix_size + to);
+    }
+
+
+    QString DataTypeRegistry::conversionKernel(int from, int to) const
+    {
+        QReadLocker locker(&lock_);
+        return kernels_.value(qMakePair(from, to));
+    }
+
+
+    QVector<int> DataTypeRegistry::compatibleTypes(int from) const
+    {
+        Snapshot const* registry = snapshot();
+        if ((from < 0) or (from >= registry->types))
+        {
+            return {};
+        }
+        return registry->compatible.at(from); // shared, not copied
+    }
+
+
+    DataTypeRegistry::Snapshot const* DataTypeRegistry::snapshot() const
+    {
+        Snapshot const* current = snapshot_.loadAcquire();
+        if (current != nullptr)
+        {
+            return current;
+        }
+
+        QWriteLocker locker(&lock_);
+        current = snapshot_.loadAcquire(); // another thread may have built it meanwhile.
+        if (current != nullptr)
+        {
+            return current;
+        }
+
+        Snapshot* built = new Snapshot{names_.size(), matrix_size_, costs_, {}};
+        built->compatible.reserve(conversions_.size());
+        for (int from = 0; from < conversions_.size(); ++from)
+        {
+            built->compatible.append(QVector<int>{from} + conversions_.at(from));
+        }
+
+        snapshots_.emplace_back(built);
+        snapshot_.storeRelease(built);
+        return built;
+    }
+
+
+    void DataTypeRegistry::invalidateSnapshot()
+    {
+        snapshot_.storeRelease(nullptr);
+    }
+
+
+    void DataTypeRegistry::reserveMatrix(int types)
+    {
+        QVector<int> costs(types * types, -1);
+        for (int from = 0; from < matrix_size_; ++from)
+        {
+            std::copy(costs_.constBegin() + from * matrix_size_, costs_.constBegin() + (from + 1) * matrix_size_,
+                      costs.begin() + from * types);
+        }
+        costs_ = costs;
+        matrix_size_ = types;
+    }
+}
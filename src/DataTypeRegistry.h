@@ -0,0 +1,89 @@
+#ifndef PIPER_DATA_TYPE_REGISTRY_H
+#define PIPER_DATA_TYPE_REGISTRY_H
+
+#include <QAtomicPointer>
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+namespace piper
+{
+    /// \brief Intern data type names to compact integer ids and store the implicit conversions between them.
+    /// Ids are dense (0, 1, 2...) and stable for the application lifetime: they can be used as array indexes.
+    /// Compatibility is a precomputed matrix: checking a connection is one lookup.
+    /// The registry is thread safe. Compatibility queries (checked on every move of a link drag) read an immutable
+    /// snapshot of the matrix without locking: it is rebuilt on the first query after a registration.
+    class DataTypeRegistry
+    {
+    public:
+        static constexpr int invalidId = -1;
+
+        static DataTypeRegistry& instance();
+
+        // Return the id of the data type, registering it if needed.
+        int intern(QString const& dataType);
+
+        // Return the id of the data type, or invalidId if it is not registered.
+        int id(QString const& dataType) const;
+
+        QString name(int id) const;
+        int count() const;
+
+        // Declare that a 'from' value can be implicitly converted to a 'to' input. The kernel names the runtime
+        // operation performing the conversion.
+        void addConversion(int from, int to, int cost, QString const& kernel);
+
+        // Cost of the conversion from -> to: 0 for the same type, -1 when the types are not compatible or not
+        // registered.
+        int conversionCost(int from, int to) const;
+        bool isCompatible(int from, int to) const { return conversionCost(from, to) >= 0; }
+
+        // Runtime operation converting from -> to (empty when no conversion is needed or possible).
+        QString conversionKernel(int from, int to) const;
+
+        // Types of the inputs accepting a 'from' value (including 'from' itself).
+        QVector<int> compatibleTypes(int from) const;
+
+    private:
+        // Compatibility data of the registered types, never modified once published.
+        struct Snapshot
+        {
+            int types;
+            int matrix_size;
+            QVector<int> costs;
+            QVector<QVector<int>> compatible;   // from -> types of the inputs accepting it (including itself)
+        };
+
+        DataTypeRegistry() = default;
+        virtual ~DataTypeRegistry() = default;
+
+        // Grow the compatibility matrix to hold at least the given number of types (lock shall be held).
+        void reserveMatrix(int types);
+
+        // Current snapshot, built if a registration happened since the last one.
+        Snapshot const* snapshot() const;
+
+        // The next query shall rebuild the snapshot (write lock shall be held).
+        void invalidateSnapshot();
+
+        mutable QReadWriteLock lock_;
+        QHash<QString, int> ids_;
+        QVector<QString> names_;
+
+        int matrix_size_{0};
+        QVector<int> costs_;                            // matrix_size_ * matrix_size_, row: from, column: to
+        QHash<QPair<int, int>, QString> kernels_;       // (from, to) -> conversion kernel
+        QVector<QVector<int>> conversions_;             // from -> convertible types (not including itself)
+
+        mutable QAtomicPointer<Snapshot const> snapshot_{nullptr};
+        mutable std::vector<std::unique_ptr<Snapshot const>> snapshots_; // every published snapshot: a reader may
+                                                                         // still use a previous one
+    };
+}
+
+#endif
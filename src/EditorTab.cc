@@ -1,8 +1,10 @@
 #include "EditorTab.h"
 #include "EditorWidget.h"
+#include "Scene.h"
 
 #include <QDebug>
 #include <QTabBar>
+#include <QMessageBox>
 #include <QMouseEvent>
 #include <QPushButton>
 
@@ -41,6 +43,29 @@ namespace piper
     }
 
 
+    PendingEditor::PendingEditor(QString const& filename, ProjectEntry const& entry)
+        : QLabel(tr("Loading..."))
+        , filename_(filename)
+        , entry_(entry)
+    {
+        setAlignment(Qt::AlignCenter);
+    }
+
+
+    void PendingEditor::relocate(QString const& filename, ProjectEntry const& entry)
+    {
+        filename_ = filename;
+        entry_ = entry;
+    }
+
+
+    void PendingEditor::setError(QString const& error)
+    {
+        setText(error);
+        has_error_ = true;
+    }
+
+
     EditorTab::EditorTab(QWidget* parent)
         : QTabWidget(parent)
         , tabNameValidator_(new TabNameValidator(this))
@@ -60,12 +85,19 @@ namespace piper
         // Connect signal to manage tab creation/rename/deletion
         QObject::connect(tb,   &QPushButton::clicked,            this, &EditorTab::createNewEditorTab);
         QObject::connect(this, &QTabWidget::tabCloseRequested,   this, &EditorTab::closeEditorTab);
+
+        // Connected first: the pending tab is materialized before the other receivers are notified.
+        QObject::connect(this, &QTabWidget::currentChanged,      this, &EditorTab::onCurrentChanged);
     }
 
 
     QString EditorTab::name(int32_t index) const
     {
        TabHeaderEdit* edit = static_cast<TabHeaderEdit*>(tabBar()->tabButton(index, QTabBar::LeftSide));
+       if (edit == nullptr)
+       {
+           return {};
+       }
        return edit->text();
     }
 
@@ -79,23 +111,107 @@ namespace piper
 
     EditorWidget* EditorTab::createNewEditorTab()
     {
+        QString defaultText = "unamed pipeline";
+        tabNameValidator_->fixup(defaultText);
+
         EditorWidget* editor = new EditorWidget();
+        addEditorTab(editor, defaultText);
+        return editor;
+    }
+
+
+    int32_t EditorTab::addEditorTab(EditorWidget* editor, QString const& name)
+    {
         int32_t index = addTab(editor, "");
+        createTabHeader(index, name);
+        return index;
+    }
 
-        QString defaultText = "unamed pipeline";
-        tabNameValidator_->fixup(defaultText);
 
-        TabHeaderEdit* edit = new TabHeaderEdit(defaultText);
+    void EditorTab::createTabHeader(int32_t index, QString const& name)
+    {
+        TabHeaderEdit* edit = new TabHeaderEdit(name);
         edit->setFrame(false);
         edit->setStyleSheet("QLineEdit { background:transparent; }");
         edit->setValidator(tabNameValidator_);
         tabBar()->setTabButton(index, QTabBar::LeftSide, edit);
         QObject::connect(edit, &QLineEdit::editingFinished, this, &EditorTab::tabNameEdited);
+    }
+
+
+    void EditorTab::createPendingTab(QString const& filename, ProjectEntry const& entry)
+    {
+        // The first tab becomes the current one: materialize it once its header exists.
+        blockSignals(true);
+        int32_t index = addTab(new PendingEditor(filename, entry), "");
+        createTabHeader(index, entry.name);
+        blockSignals(false);
 
+        if (index == currentIndex())
+        {
+            emit currentChanged(index);
+        }
+    }
+
+
+    PendingEditor* EditorTab::pendingEditor(int32_t index) const
+    {
+        return qobject_cast<PendingEditor*>(widget(index));
+    }
+
+
+    EditorWidget* EditorTab::editor(int32_t index)
+    {
+        PendingEditor* pending = pendingEditor(index);
+        if (pending == nullptr)
+        {
+            return qobject_cast<EditorWidget*>(widget(index));
+        }
+
+        if (pending->hasError())
+        {
+            return nullptr;
+        }
+
+        Graph graph;
+        QString error;
+        if (not readProjectTab(pending->filename(), pending->entry(), graph, error))
+        {
+            pending->setError(error);
+            QMessageBox::warning(this, tr("Load"), error);
+            return nullptr;
+        }
+
+        EditorWidget* editor = new EditorWidget();
+        editor->scene()->loadGraph(graph);
+
+        // Swap the pages: the header keeps the tab name, which may have been edited meanwhile.
+        QString const tabName = name(index);
+        bool const current = (index == currentIndex());
+        blockSignals(true);
+        removeTab(index);
+        insertTab(index, editor, "");
+        createTabHeader(index, tabName);
+        if (current)
+        {
+            setCurrentIndex(index);
+        }
+        blockSignals(false);
+
+        pending->deleteLater();
         return editor;
     }
 
 
+    void EditorTab::onCurrentChanged(int32_t index)
+    {
+        if (index >= 0)
+        {
+            editor(index);
+        }
+    }
+
+
     void EditorTab::closeEditorTab(int32_t index)
     {
         widget(index)->deleteLater(); // Note: removeTab do not destroy the widget.
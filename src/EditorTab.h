@@ -2,10 +2,13 @@
 #define PIPER_TAB_H
 
 #include <QTabWidget>
+#include <QLabel>
 #include <QLineEdit>
 #include <QValidator>
 #include <QDebug>
 
+#include "Project.h"
+
 namespace piper
 {
     class EditorWidget;
@@ -32,6 +35,32 @@ namespace piper
     };
     
     
+    // Cheap page shown for a tab which content is still in the project file: the editor is built on first activation.
+    class PendingEditor : public QLabel
+    {
+        Q_OBJECT
+
+    public:
+        PendingEditor(QString const& filename, ProjectEntry const& entry);
+        virtual ~PendingEditor() = default;
+
+        QString const& filename() const   { return filename_; }
+        ProjectEntry const& entry() const { return entry_;    }
+
+        // The project file was rewritten: the content moved.
+        void relocate(QString const& filename, ProjectEntry const& entry);
+
+        // The content cannot be loaded: the error is shown instead of the editor.
+        void setError(QString const& error);
+        bool hasError() const { return has_error_; }
+
+    private:
+        QString filename_;
+        ProjectEntry entry_;
+        bool has_error_{false};
+    };
+
+
     class EditorTab : public QTabWidget
     {
         Q_OBJECT
@@ -41,13 +70,31 @@ namespace piper
         
         QString name(int32_t index) const;
         void setName(int32_t index, QString const& name);
+
+        // Editor of the tab: a pending tab is materialized. Return nullptr if its content cannot be loaded: the tab
+        // stays pending (and shows the error), so that saving the project still copies its content.
+        EditorWidget* editor(int32_t index);
+
+        // Placeholder of the tab, or nullptr if the tab is already materialized.
+        PendingEditor* pendingEditor(int32_t index) const;
+
+        // Add a tab showing the editor (the tab takes its ownership).
+        int32_t addEditorTab(EditorWidget* editor, QString const& name);
+
+        // Add a tab which content is loaded from the project file when the tab is first activated.
+        void createPendingTab(QString const& filename, ProjectEntry const& entry);
         
     public slots:
         EditorWidget* createNewEditorTab();
         void closeEditorTab(int32_t index);
         void tabNameEdited();
         
+    private slots:
+        void onCurrentChanged(int32_t index);
+
     private:
+        void createTabHeader(int32_t index, QString const& name);
+
         TabNameValidator* tabNameValidator_;
     };
 }
@@ -6,6 +6,7 @@
 #include "Node.h"
 #include "Link.h"
 #include "NodeCreator.h"
+#include "Commands.h"
 
 #include <cmath>
 #include <QColorDialog>
@@ -79,6 +80,7 @@ namespace piper
             if (node != nullptr)
             {
                 scene_->addNode(node);
+                scene_->undoStack().push(new AddItemsCommand(scene_, {node}));
             }
         });
 
@@ -163,6 +165,26 @@ namespace piper
     void EditorWidget::loadJson(QJsonObject& json)
     {
         scene_->onImportJson(json);
+        onImported();
+    }
+
+
+    void EditorWidget::loadGraph(Graph& graph, QStringList const& errors)
+    {
+        scene_->onImport(graph, errors);
+        onImported();
+    }
+
+
+    void EditorWidget::endImport(QStringList const& errors)
+    {
+        scene_->reportImport(errors);
+        onImported();
+    }
+
+
+    void EditorWidget::onImported()
+    {
         QModelIndex index = scene_->modes()->index(0, 0);
         if (index.isValid())
         {
@@ -13,6 +13,7 @@ namespace piper
 {
     class Scene;
     class ExportBackend;
+    class Graph;
 
     class EditorWidget : public QWidget
     {
@@ -27,6 +28,12 @@ namespace piper
 
         void onExport(ExportBackend& backend);
         void loadJson(QJsonObject& json);
+        void loadGraph(Graph& graph, QStringList const& errors);
+
+        // The scene was filled by a SceneLoader: report the problems and show the pipeline.
+        void endImport(QStringList const& errors);
+
+        Scene* scene() const { return scene_; }
 
     public slots:
         void onAddStage();
@@ -37,6 +44,9 @@ namespace piper
         void onRmMode();
 
     private:
+        // Select the first mode and show the imported pipeline.
+        void onImported();
+
         Ui::EditorWidget* ui_;
         Scene* scene_;
     };
@@ -0,0 +1,120 @@
+#include "ExampleNodes.h"
+#include "NodeCreator.h"
+
+namespace piper
+{
+    void registerExampleNodes()
+    {
+        NodeCreator::instance().addItem(
+        {
+            "SinWave",
+            "Sinus generator",
+            "Example",
+            "Generator",
+            {
+                {"output", "float", AttributeInfo::Type::output},
+                {"amplitude", "float", AttributeInfo::Type::member},
+                {"frequency", "float", AttributeInfo::Type::member},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "Random",
+            "",
+            "",
+            "",
+            {
+                {"output", "float", AttributeInfo::Type::output},
+                {"min", "float", AttributeInfo::Type::member},
+                {"max", "float", AttributeInfo::Type::member},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "Add",
+            "",
+            "",
+            "",
+            {
+                {"inputA", "float", AttributeInfo::Type::input},
+                {"inputB", "float", AttributeInfo::Type::input},
+                {"output", "float", AttributeInfo::Type::output},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "LowPass",
+            "",
+            "Example",
+            "Filters",
+            {
+                {"inputA", "float", AttributeInfo::Type::input},
+                {"output", "float", AttributeInfo::Type::output},
+                {"Fc", "float", AttributeInfo::Type::member},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "cast<float, int>",
+            "Transform a float to integer \nWarning! take care of precision loss!",
+            "",
+            "",
+            {
+                {"input", "float", AttributeInfo::Type::input},
+                {"output", "int", AttributeInfo::Type::output}
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "cast<float, customType>",
+            "",
+            "",
+            "",
+            {
+                {"input", "float", AttributeInfo::Type::input},
+                {"output", "customType", AttributeInfo::Type::output}
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "probe<float>",
+            "Record updates in the telemetry system",
+            "",
+            "",
+            {
+                {"input", "float", AttributeInfo::Type::input},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "probe<int>",
+            "Record updates in the telemetry system",
+            "",
+            "utilities",
+            {
+                {"input", "int", AttributeInfo::Type::input},
+            }
+        });
+
+        NodeCreator::instance().addItem(
+        {
+            "probe<customType>",
+            "Record updates in the telemetry system",
+            "",
+            "utilities",
+            {
+                {"input", "customType", AttributeInfo::Type::input},
+            }
+        });
+
+        // Implicit conversions (no cast node is needed to connect these types).
+        NodeCreator::instance().addConversion({"int", "float", 1});
+    }
+}
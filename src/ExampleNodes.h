@@ -0,0 +1,10 @@
+#ifndef PIPER_EXAMPLE_NODES_H
+#define PIPER_EXAMPLE_NODES_H
+
+namespace piper
+{
+    // Register the example node types and conversions: shared by the editor and the command line tools.
+    void registerExampleNodes();
+}
+
+#endif
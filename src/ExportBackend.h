@@ -12,11 +12,11 @@ namespace piper
     class ExportBackend
     {
     public:
-        // init() is called befre anything else.
-        virtual void init(QString const& filename) = 0;
+        // init() is called befre anything else. Return false if the output cannot be opened.
+        virtual bool init(QString const& filename) = 0;
 
-        // finalize() is called when the export is finished.
-        virtual void finalize(QString const& filename) = 0;
+        // finalize() is called when the export is finished. Return false if the output was not fully written.
+        virtual bool finalize(QString const& filename) = 0;
 
         // Start a new pipeline
         virtual void startPipeline(QString const& pipelineName) = 0;
@@ -30,8 +30,9 @@ namespace piper
         // Each node is composed of its metadata and a map attributes/value
         virtual void writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes) = 0;
 
-        // one call per link
-        virtual void writeLink(QString const& from, QString const& output, QString const& to, QString const& input, QString const& type) = 0;
+        // one call per link. conversion is the kernel converting the output type to the input one (empty if none).
+        virtual void writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                               QString const& type, QString const& conversion) = 0;
 
         // one call per mode
         virtual void writeMode(QString const& name, QHash<QString, Mode> const& config) = 0;
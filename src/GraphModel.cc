@@ -0,0 +1,764 @@
+#include "GraphModel.h"
+#include "DataTypeRegistry.h"
+#include "ExportBackend.h"
+#include "NodeCreator.h"
+
+#include <QJsonArray>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+
+#include <cmath>
+
+namespace piper
+{
+    QDataStream& operator<<(QDataStream& out, AttributeInfo const& info)
+    {
+        out << info.name << info.dataType << info.type;
+        return out;
+    }
+
+
+    QDataStream& operator>>(QDataStream& in, AttributeInfo& info)
+    {
+        int type;
+        in >> info.name >> info.dataType >> type;
+        info.type = static_cast<AttributeInfo::Type>(type);
+        info.typeId = DataTypeRegistry::instance().intern(info.dataType);
+        return in;
+    }
+
+
+    MemberKind memberKind(QString const& dataType)
+    {
+        static QStringList const integers{"int", "integer", "int32_t", "int64_t"};
+        static QStringList const reals{"float", "double", "real", "float32_t", "float64_t"};
+
+        if (integers.contains(dataType))
+        {
+            return MemberKind::integer;
+        }
+        if (reals.contains(dataType))
+        {
+            return MemberKind::real;
+        }
+        if (dataType == "string")
+        {
+            return MemberKind::text;
+        }
+        return MemberKind::none;
+    }
+
+
+    QVariant defaultMemberValue(MemberKind kind)
+    {
+        switch (kind)
+        {
+            case MemberKind::integer: { return 0;         }
+            case MemberKind::real:    { return 0.0;       }
+            case MemberKind::text:    { return QString(); }
+            case MemberKind::none:    { return {};        }
+        }
+        return {};
+    }
+
+
+    QVariant toMemberValue(MemberKind kind, QVariant const& data)
+    {
+        switch (data.type())
+        {
+            //QJsonValue always returns QVariant::Double with numbers
+            case QVariant::Int:
+            case QVariant::Double:
+            {
+                if (kind == MemberKind::integer)
+                {
+                    return data.toInt();
+                }
+                if (kind == MemberKind::real)
+                {
+                    return data.toDouble();
+                }
+                return {};
+            }
+            case QVariant::String:
+            {
+                if (kind == MemberKind::text)
+                {
+                    return data.toString();
+                }
+                return {};
+            }
+            default:
+            {
+                return {};
+            }
+        }
+    }
+
+
+    namespace
+    {
+        // Value stored by an attribute, as its graphical counterpart would store it.
+        QVariant toAttributeValue(AttributeInfo const& info, QVariant const& data)
+        {
+            if (info.type == AttributeInfo::Type::member)
+            {
+                return toMemberValue(memberKind(info.dataType), data);
+            }
+
+            // Inputs and outputs store their connector side.
+            if (data.canConvert(QMetaType::Bool))
+            {
+                return data.toBool();
+            }
+            return false;
+        }
+
+        Mode modeFromString(QString const& mode)
+        {
+            if (mode == "Neutral")
+            {
+                return Mode::neutral;
+            }
+            if (mode == "Disable")
+            {
+                return Mode::disable;
+            }
+            return Mode::enable;
+        }
+
+        int typeIdOf(AttributeInfo const& info)
+        {
+            if (info.typeId != DataTypeRegistry::invalidId)
+            {
+                return info.typeId;
+            }
+            return DataTypeRegistry::instance().intern(info.dataType);
+        }
+    }
+
+
+    GraphAttribute const* GraphNode::attribute(QString const& name) const
+    {
+        for (auto const& attribute : attributes)
+        {
+            if (attribute.info.name == name)
+            {
+                return &attribute;
+            }
+        }
+        return nullptr;
+    }
+
+
+    GraphAttribute* GraphNode::attribute(QString const& name)
+    {
+        return const_cast<GraphAttribute*>(static_cast<GraphNode const*>(this)->attribute(name));
+    }
+
+
+    GraphAttribute const* GraphNode::attribute(AttributeInfo::Type type, QString const& name) const
+    {
+        for (auto const& attribute : attributes)
+        {
+            if ((attribute.info.type == type) and (attribute.info.name == name))
+            {
+                return &attribute;
+            }
+        }
+        return nullptr;
+    }
+
+
+    bool GraphNode::setData(QString const& name, QVariant const& data)
+    {
+        GraphAttribute* target = attribute(name);
+        if (target == nullptr)
+        {
+            return false;
+        }
+
+        QVariant const value = toAttributeValue(target->info, data);
+        if (value.isValid())
+        {
+            target->data = value;
+        }
+        return true;
+    }
+
+
+    GraphNode* Graph::addNode(GraphNode const& node)
+    {
+        if (nodes_index_.contains(node.name))
+        {
+            return nullptr;
+        }
+
+        nodes_index_.insert(node.name, nodes_.size());
+        nodes_.append(node);
+        return &nodes_.last();
+    }
+
+
+    GraphNode* Graph::createNode(QString const& type, QString const& name, QString const& stage, QPointF const& pos)
+    {
+        Item const* item = NodeCreator::instance().item(type);
+        if (item == nullptr)
+        {
+            return nullptr;
+        }
+
+        GraphNode node{type, name, stage, pos, {}};
+        for (auto const& info : item->attributes)
+        {
+            if (info.type == AttributeInfo::Type::member)
+            {
+                node.attributes.append({info, defaultMemberValue(memberKind(info.dataType))});
+            }
+            else
+            {
+                node.attributes.append({info, false});
+            }
+        }
+        return addNode(node);
+    }
+
+
+    GraphNode const* Graph::node(QString const& name) const
+    {
+        auto it = nodes_index_.constFind(name);
+        if (it == nodes_index_.constEnd())
+        {
+            return nullptr;
+        }
+        return &nodes_.at(it.value());
+    }
+
+
+    GraphNode* Graph::node(QString const& name)
+    {
+        auto it = nodes_index_.constFind(name);
+        if (it == nodes_index_.constEnd())
+        {
+            return nullptr;
+        }
+        return &nodes_[it.value()];
+    }
+
+
+    void Graph::clear()
+    {
+        nodes_.clear();
+        nodes_index_.clear();
+        links_.clear();
+        stages_.clear();
+        modes_.clear();
+    }
+
+
+    void Graph::loadJson(QJsonObject const& json, QStringList& errors)
+    {
+        // load stages
+        QJsonArray stages = json["Stages"].toArray();
+        for (int i = 0; i < stages.size(); ++i)
+        {
+            addStage({stages[i].toString(), generateRandomColor()});
+        }
+
+        // load nodes (exported pipelines name them "Nodes")
+        QJsonObject steps = json.contains("Steps") ? json["Steps"].toObject() : json["Nodes"].toObject();
+        for (auto step = steps.constBegin(); step != steps.constEnd(); ++step)
+        {
+            QJsonObject const object = step.value().toObject();
+            QString const type = object["type"].toString();
+
+            GraphNode* node = createNode(type, step.key());
+            if (node == nullptr)
+            {
+                errors.append("Cannot create node " + step.key() + ": type " + type + " is unknown.");
+                continue;
+            }
+
+            for (auto member = object.constBegin(); member != object.constEnd(); ++member)
+            {
+                if (member.key() == "type")
+                {
+                    continue;
+                }
+                if (member.key() == "stage")
+                {
+                    node->stage = member.value().toString();
+                    continue;
+                }
+
+                if (not node->setData(member.key(), member.value().toVariant()))
+                {
+                    errors.append("Attribute " + member.key() + " not found: version mismatch ?");
+                }
+            }
+        }
+
+        // load links
+        QJsonArray links = json["Links"].toArray();
+        for (int i = 0; i < links.size(); ++i)
+        {
+            QJsonObject link = links[i].toObject();
+            addLink({link["from"].toString(), link["out"].toString(), link["to"].toString(), link["in"].toString()});
+        }
+
+        // load modes
+        QJsonObject modes = json["Modes"].toObject();
+        QString const defaultMode = modes.value("default").toString(); // the mode to use at startup.
+        for (auto it = modes.constBegin(); it != modes.constEnd(); ++it)
+        {
+            if (it.key() == "default")
+            {
+                continue;
+            }
+
+            GraphMode mode;
+            mode.name = it.key();
+            mode.isDefault = (it.key() == defaultMode);
+
+            QJsonObject configuration = it.value().toObject()["configuration"].toObject();
+            for (auto node = configuration.constBegin(); node != configuration.constEnd(); ++node)
+            {
+                mode.nodes.insert(node.key(), modeFromString(node.value().toString()));
+            }
+            addMode(mode);
+        }
+    }
+
+
+    void Graph::placeNodesByStage(QPointF const& origin)
+    {
+        struct stageInfo {int column; int size;};
+        QHash<QString, stageInfo> stageIndex;
+
+        int column = 0;
+        for (auto const& stage : stages_)
+        {
+            stageIndex.insert(stage.name, {column, 0});
+            ++column;
+        }
+
+        // Handle steps without stage
+        stageIndex.insert("", {column, 0});
+
+        for (auto& node : nodes_)
+        {
+            stageInfo& info = stageIndex[node.stage];
+            node.pos = QPointF(origin.x() + 300 * info.column, origin.y() + 200 * info.size);
+            ++info.size;
+        }
+    }
+
+
+    QString Graph::linkProblem(LinkData const& link, QSet<QString>& connections) const
+    {
+        QString const description = link.from + "." + link.output + " -> " + link.to + "." + link.input;
+        GraphNode const* from = node(link.from);
+        GraphNode const* to   = node(link.to);
+        if ((from == nullptr) or (to == nullptr))
+        {
+            return "Link " + description + ": node not found";
+        }
+
+        GraphAttribute const* output = from->attribute(AttributeInfo::Type::output, link.output);
+        GraphAttribute const* input  = to->attribute(AttributeInfo::Type::input, link.input);
+        if (output == nullptr)
+        {
+            return "Link " + description + ": " + link.output + " is not an output";
+        }
+        if (input == nullptr)
+        {
+            return "Link " + description + ": " + link.input + " is not an input";
+        }
+
+        if (from == to)
+        {
+            return "Link " + description + ": a node cannot be connected to itself";
+        }
+
+        if (not DataTypeRegistry::instance().isCompatible(typeIdOf(output->info), typeIdOf(input->info)))
+        {
+            return "Link " + description + ": type mismatch (" + output->info.dataType + " to "
+                   + input->info.dataType + ")";
+        }
+
+        if (connections.contains(description))
+        {
+            return "Link " + description + ": duplicated";
+        }
+        connections.insert(description);
+        return {};
+    }
+
+
+    QStringList Graph::resolveLinks()
+    {
+        QStringList errors;
+        QSet<QString> connections;
+        QVector<LinkData> resolved;
+        resolved.reserve(links_.size());
+        for (auto const& link : links_)
+        {
+            QString const problem = linkProblem(link, connections);
+            if (problem.isEmpty())
+            {
+                resolved.append(link);
+            }
+            else
+            {
+                errors.append(problem);
+            }
+        }
+        links_.swap(resolved);
+        return errors;
+    }
+
+
+    QStringList Graph::validate() const
+    {
+        QStringList errors;
+
+        // -------- stages -------- //
+        QSet<QString> stages;
+        for (auto const& stage : stages_)
+        {
+            stages.insert(stage.name);
+        }
+        for (auto const& node : nodes_)
+        {
+            if ((not node.stage.isEmpty()) and (not stages.contains(node.stage)))
+            {
+                errors.append("Node " + node.name + " uses the unknown stage " + node.stage);
+            }
+        }
+
+        // -------- links -------- //
+        QHash<QString, QSet<QString>> successors; // node graph used to detect cycles
+        QSet<QString> connections;
+        for (auto const& link : links_)
+        {
+            QString const problem = linkProblem(link, connections);
+            if (not problem.isEmpty())
+            {
+                errors.append(problem);
+                continue;
+            }
+            successors[link.from].insert(link.to);
+        }
+
+        // -------- cycles (Kahn's algorithm) -------- //
+        QHash<QString, int> predecessorCount;
+        for (auto it = successors.constBegin(); it != successors.constEnd(); ++it)
+        {
+            for (auto const& successor : it.value())
+            {
+                ++predecessorCount[successor];
+            }
+        }
+
+        QStringList ready;
+        for (auto const& node : nodes_)
+        {
+            if (predecessorCount.value(node.name, 0) == 0)
+            {
+                ready.append(node.name);
+            }
+        }
+
+        int sorted = 0;
+        while (not ready.isEmpty())
+        {
+            QString const current = ready.takeLast();
+            ++sorted;
+            for (auto const& successor : successors.value(current))
+            {
+                if (--predecessorCount[successor] == 0)
+                {
+                    ready.append(successor);
+                }
+            }
+        }
+
+        if (sorted != nodes_.size())
+        {
+            QStringList cyclic;
+            for (auto it = predecessorCount.constBegin(); it != predecessorCount.constEnd(); ++it)
+            {
+                if (it.value() > 0)
+                {
+                    cyclic.append(it.key());
+                }
+            }
+            cyclic.sort();
+            errors.append("The pipeline contains a cycle between the nodes: " + cyclic.join(", "));
+        }
+
+        // -------- modes -------- //
+        for (auto const& mode : modes_)
+        {
+            for (auto it = mode.nodes.constBegin(); it != mode.nodes.constEnd(); ++it)
+            {
+                if (node(it.key()) == nullptr)
+                {
+                    errors.append("Mode " + mode.name + " configures the unknown node " + it.key());
+                }
+            }
+        }
+
+        return errors;
+    }
+
+
+    void Graph::exportGraph(ExportBackend& backend) const
+    {
+        // -------- stages -------- //
+        QVector<QString> stages;
+        for (auto const& stage : stages_)
+        {
+            stages.append(stage.name);
+        }
+        backend.writeStages(stages);
+
+        // -------- nodes -------- //
+        for (auto const& node : nodes_)
+        {
+            QHash<QString, QVariant> attributes;
+            for (auto const& attribute : node.attributes)
+            {
+                if (attribute.info.type == AttributeInfo::Type::member)
+                {
+                    attributes.insert(attribute.info.name, attribute.data);
+                }
+            }
+
+            backend.writeNode(node.type, node.name, node.stage, attributes);
+        }
+
+        // -------- links -------- //
+        for (auto const& link : links_)
+        {
+            GraphNode const* from = node(link.from);
+            GraphNode const* to   = node(link.to);
+            GraphAttribute const* output = nullptr;
+            GraphAttribute const* input  = nullptr;
+            if ((from != nullptr) and (to != nullptr))
+            {
+                output = from->attribute(AttributeInfo::Type::output, link.output);
+                input  = to->attribute(AttributeInfo::Type::input, link.input);
+            }
+            if ((output == nullptr) or (input == nullptr))
+            {
+                continue; // invalid link: see validate().
+            }
+
+            QString const conversion = DataTypeRegistry::instance().conversionKernel(typeIdOf(output->info),
+                                                                                     typeIdOf(input->info));
+            backend.writeLink(link.from, link.output, link.to, link.input, output->info.dataType, conversion);
+        }
+
+        // -------- modes -------- //
+        for (auto const& mode : modes_)
+        {
+            if (mode.isDefault)
+            {
+                backend.writeDefaultMode(mode.name);
+            }
+            backend.writeMode(mode.name, mode.nodes);
+        }
+    }
+
+
+    QDataStream& operator<<(QDataStream& out, GraphNode const& node)
+    {
+        // Save node data
+        out << node.type << node.name << node.stage << node.pos;
+
+        // save node attributes
+        out << node.attributes.size();
+        for (auto const& attribute : node.attributes)
+        {
+            out << attribute.info << attribute.data;
+        }
+
+        return out;
+    }
+
+
+    QDataStream& operator>>(QDataStream& in, GraphNode& node)
+    {
+        // load node data
+        in >> node.type >> node.name >> node.stage >> node.pos;
+
+        // load node attributes
+        int attributesSize;
+        in >> attributesSize;
+        node.attributes.clear();
+        node.attributes.reserve(attributesSize);
+        for (int i = 0; i < attributesSize; ++i)
+        {
+            GraphAttribute attribute;
+            in >> attribute.info >> attribute.data;
+            node.attributes.append(attribute);
+        }
+
+        return in;
+    }
+
+
+    namespace
+    {
+        // Item of the editor models (stages, modes), streamed with the QStandardItem layout: (role, value) pairs then
+        // the item flags. QStandardItem itself is not needed: the model stays usable without a GUI.
+        struct ModelItem
+        {
+            QVector<QPair<int, QVariant>> values;
+            qint32 flags{Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable | Qt::ItemIsDragEnabled};
+
+            QVariant data(int role) const
+            {
+                for (auto const& value : values)
+                {
+                    if (value.first == role)
+                    {
+                        return value.second;
+                    }
+                }
+                return {};
+            }
+        };
+
+        QDataStream& operator<<(QDataStream& out, ModelItem const& item)
+        {
+            return out << item.values << item.flags;
+        }
+
+        QDataStream& operator>>(QDataStream& in, ModelItem& item)
+        {
+            return in >> item.values >> item.flags;
+        }
+    }
+
+
+    QDataStream& operator<<(QDataStream& out, Graph const& graph)
+    {
+        // Stages and modes are saved as the items of the editor models.
+        out << graph.stages().size();
+        for (auto const& stage : graph.stages())
+        {
+            ModelItem item;
+            item.values.append({Qt::DecorationRole, stage.color});
+            item.values.append({Qt::DisplayRole, stage.name});
+            out << item;
+        }
+
+        out << graph.modes().size();
+        for (auto const& mode : graph.modes())
+        {
+            QHash<QString, QVariant> nodes;
+            for (auto it = mode.nodes.constBegin(); it != mode.nodes.constEnd(); ++it)
+            {
+                nodes.insert(it.key(), static_cast<int>(it.value()));
+            }
+
+            ModelItem item;
+            item.values.append({Qt::DisplayRole, mode.name});
+            item.values.append({Qt::UserRole + 1, mode.isSelected});
+            item.values.append({Qt::UserRole + 2, nodes});
+            if (mode.isDefault)
+            {
+                item.values.append({Qt::DecorationRole, true}); // the editor shows a star: any valid value marks it
+            }
+            out << item;
+        }
+
+        out << graph.nodes().size();
+        for (auto const& node : graph.nodes())
+        {
+            out << node;
+        }
+
+        out << graph.links().size();
+        for (auto const& link : graph.links())
+        {
+            out << link.from << link.output;
+            out << link.to   << link.input;
+        }
+
+        return out;
+    }
+
+
+    QDataStream& operator>>(QDataStream& in, Graph& graph)
+    {
+        graph.clear();
+
+        int stageCount;
+        in >> stageCount;
+        for (int i = 0; i < stageCount; ++i)
+        {
+            ModelItem item;
+            in >> item;
+            graph.addStage({item.data(Qt::DisplayRole).toString(), item.data(Qt::DecorationRole).value<QColor>()});
+        }
+
+        int modeCount;
+        in >> modeCount;
+        for (int i = 0; i < modeCount; ++i)
+        {
+            ModelItem item;
+            in >> item;
+
+            GraphMode mode;
+            mode.name = item.data(Qt::DisplayRole).toString();
+            mode.isDefault = item.data(Qt::DecorationRole).isValid();
+            mode.isSelected = item.data(Qt::UserRole + 1).toBool();
+            QHash<QString, QVariant> nodes = item.data(Qt::UserRole + 2).toHash();
+            for (auto it = nodes.constBegin(); it != nodes.constEnd(); ++it)
+            {
+                mode.nodes.insert(it.key(), static_cast<Mode>(it.value().toInt()));
+            }
+            graph.addMode(mode);
+        }
+
+        int nodeCount;
+        in >> nodeCount;
+        for (int i = 0; i < nodeCount; ++i)
+        {
+            GraphNode node;
+            in >> node;
+            graph.addNode(node);
+        }
+
+        int linkCount;
+        in >> linkCount;
+        for (int i = 0; i < linkCount; ++i)
+        {
+            LinkData link;
+            in >> link.from >> link.output >> link.to >> link.input;
+            graph.addLink(link);
+        }
+
+        return in;
+    }
+
+
+    QColor generateRandomColor()
+    {
+        // procedural color generator: the gold ratio (pipelines may be loaded concurrently)
+        static QMutex mutex;
+        QMutexLocker locker(&mutex);
+        static double nextColorHue = 1.0 / (rand() % 100); // don't need a proper random here
+        constexpr double golden_ratio_conjugate = 0.618033988749895; // 1 / phi
+        nextColorHue += golden_ratio_conjugate;
+        nextColorHue = std::fmod(nextColorHue, 1.0);
+
+        QColor nextColor;
+        nextColor.setHsvF(nextColorHue, 0.5, 0.99);
+        return nextColor;
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef PIPER_GRAPH_MODEL_H
+#define PIPER_GRAPH_MODEL_H
+
+#include <QColor>
+#include <QDataStream>
+#include <QHash>
+#include <QJsonObject>
+#include <QPointF>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "Types.h"
+
+namespace piper
+{
+    class ExportBackend;
+
+    struct AttributeInfo
+    {
+        QString name;
+        QString dataType;
+        enum Type
+        {
+            input  = 0,
+            output = 1,
+            member = 2
+        } type;
+        int typeId{-1};     // interned dataType (see DataTypeRegistry): filled when the item is registered or loaded
+    };
+
+    QDataStream& operator<<(QDataStream& out, AttributeInfo const& info);
+    QDataStream& operator>>(QDataStream& in,  AttributeInfo& info);
+
+
+    // Describe a link by the names of its endpoints.
+    struct LinkData
+    {
+        QString from;
+        QString output;
+        QString to;
+        QString input;
+    };
+
+
+    // Kind of value held by a member attribute, deduced from its data type.
+    enum class MemberKind
+    {
+        none,
+        integer,
+        real,
+        text
+    };
+    MemberKind memberKind(QString const& dataType);
+
+    // Value of a new member.
+    QVariant defaultMemberValue(MemberKind kind);
+
+    // Convert a value to the member kind. Return an invalid QVariant if the value does not fit.
+    QVariant toMemberValue(MemberKind kind, QVariant const& data);
+
+
+    struct GraphAttribute
+    {
+        AttributeInfo info;
+        QVariant data;      // member value, or connector side (bool) for inputs and outputs
+    };
+
+
+    struct GraphNode
+    {
+        QString type;
+        QString name;
+        QString stage;
+        QPointF pos;
+        QVector<GraphAttribute> attributes;
+
+        // First attribute with this name (any direction), or nullptr.
+        GraphAttribute const* attribute(QString const& name) const;
+        GraphAttribute* attribute(QString const& name);
+
+        // Attribute with this direction and name, or nullptr (an input and an output may share a name).
+        GraphAttribute const* attribute(AttributeInfo::Type type, QString const& name) const;
+
+        // Set the value of an attribute, converted as the editor would do (invalid values are ignored).
+        // Return false if the attribute does not exist.
+        bool setData(QString const& name, QVariant const& data);
+    };
+
+
+    struct GraphStage
+    {
+        QString name;
+        QColor color;
+    };
+
+
+    struct GraphMode
+    {
+        QString name;
+        QHash<QString, Mode> nodes;     // node name -> mode (missing nodes are enabled)
+        bool isDefault{false};
+        bool isSelected{false};         // current mode of the editor
+    };
+
+
+    /// \brief A pipeline without any graphical item: nodes, links, stages and modes.
+    /// It can be loaded, validated and exported without a QApplication. Scene builds its items from it and
+    /// saves them through it: the project file and JSON formats are implemented here.
+    class Graph
+    {
+    public:
+        Graph() = default;
+        virtual ~Graph() = default;
+
+        // Node names are unique: return nullptr if the name is already used.
+        GraphNode* addNode(GraphNode const& node);
+
+        // Create a node of a type registered in the NodeCreator, with default attribute values.
+        GraphNode* createNode(QString const& type, QString const& name, QString const& stage = "",
+                              QPointF const& pos = {});
+
+        GraphNode const* node(QString const& name) const;
+        GraphNode* node(QString const& name);
+        QVector<GraphNode> const& nodes() const { return nodes_; }
+
+        void addLink(LinkData const& link) { links_.append(link); }
+        QVector<LinkData> const& links() const { return links_; }
+
+        void addStage(GraphStage const& stage) { stages_.append(stage); }
+        QVector<GraphStage> const& stages() const { return stages_; }
+
+        void addMode(GraphMode const& mode) { modes_.append(mode); }
+        QVector<GraphMode> const& modes() const { return modes_; }
+
+        void clear();
+
+        // Load a pipeline in the JSON import format (Stages, Steps, Links, Modes) or in the exported one (Nodes
+        // instead of Steps). Problems are appended to errors.
+        void loadJson(QJsonObject const& json, QStringList& errors);
+
+        // Place the nodes on a grid: one column per stage.
+        void placeNodesByStage(QPointF const& origin);
+
+        // Check links (endpoints, directions, types), stages and cycles. Return the list of problems.
+        QStringList validate() const;
+
+        // Remove the links which cannot be created (endpoints, directions, types, duplicates). Return their problems.
+        QStringList resolveLinks();
+
+        // Write the pipeline in the backend (the caller is in charge of startPipeline()/endPipeline()).
+        void exportGraph(ExportBackend& backend) const;
+
+    private:
+        // Problem of the link (empty if none). connections holds the links already checked, to detect duplicates.
+        QString linkProblem(LinkData const& link, QSet<QString>& connections) const;
+
+        QVector<GraphNode> nodes_;
+        QHash<QString, int> nodes_index_; // name -> index in nodes_
+        QVector<LinkData> links_;
+        QVector<GraphStage> stages_;
+        QVector<GraphMode> modes_;
+    };
+
+    // Project file format (.piper tab content).
+    QDataStream& operator<<(QDataStream& out, GraphNode const& node);
+    QDataStream& operator>>(QDataStream& in,  GraphNode& node);
+    QDataStream& operator<<(QDataStream& out, Graph const& graph);
+    QDataStream& operator>>(QDataStream& in,  Graph& graph);
+
+    QColor generateRandomColor();
+}
+
+#endif
@@ -6,12 +6,12 @@
 
 namespace piper
 {
-    void JsonExport::init(QString const&)
+    bool JsonExport::init(QString const&)
     {
-
+        return true;
     }
 
-    void JsonExport::finalize(QString const& filename)
+    bool JsonExport::finalize(QString const& filename)
     {
         QJsonDocument document(root_);
 
@@ -19,10 +19,11 @@ namespace piper
         if (not io.open(QIODevice::WriteOnly))
         {
             qDebug() << "Error while opening" << io.fileName();
-            return;
+            return false;
         }
 
-        io.write(document.toJson());
+        QByteArray const json = document.toJson();
+        return (io.write(json) == json.size()) and io.flush();
     }
 
     void JsonExport::startPipeline(QString const&)
@@ -69,7 +70,8 @@ namespace piper
     }
 
 
-    void JsonExport::writeLink(QString const& from, QString const& output, QString const& to, QString const& input, QString const& type)
+    void JsonExport::writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                               QString const& type, QString const& conversion)
     {
         QJsonObject link;
         link["from"] = from;
@@ -77,6 +79,10 @@ namespace piper
         link["to"] = to;
         link["in"] = input;
         link["type"] = type;
+        if (not conversion.isEmpty())
+        {
+            link["conversion"] = conversion;
+        }
         links_.append(link);
     }
 
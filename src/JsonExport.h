@@ -15,10 +15,10 @@ namespace piper
         virtual ~JsonExport() = default;
 
         // init() is called befre anything else.
-        void init(QString const& filename) override;
+        bool init(QString const& filename) override;
 
         // finalize() is called when the export is finished.
-        void finalize(QString const& filename) override;
+        bool finalize(QString const& filename) override;
 
         // Start a new pipeline
         void startPipeline(QString const&) override;
@@ -33,7 +33,8 @@ namespace piper
         void writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes) override;
 
         // one call per link
-        void writeLink(QString const& from, QString const& output, QString const& to, QString const& input, QString const& type) override;
+        void writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                       QString const& type, QString const& conversion) override;
 
         // Mode
         void writeMode(QString const& name, QHash<QString, Mode> const& config) override;
@@ -0,0 +1,155 @@
+#include "JsonImport.h"
+#include "EditorWidget.h"
+#include "Scene.h"
+
+#include <QElapsedTimer>
+#include <QMessageBox>
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace piper
+{
+    namespace
+    {
+        constexpr int sliceDuration = 16; // ms of UI thread per event loop iteration: the window stays responsive.
+        constexpr int batchSize = 64;     // items created between two clock checks.
+    }
+
+
+    JsonImport::JsonImport(QString const& filename, QWidget* parent)
+        : QObject(parent)
+        , filename_(filename)
+        , parent_(parent)
+        , progress_(tr("Reading %1...").arg(filename), tr("Cancel"), 0, 0, parent)
+    {
+        progress_.setWindowModality(Qt::WindowModal);
+        progress_.setAutoReset(false);
+        progress_.setAutoClose(false);
+
+        QObject::connect(&watcher_,  &QFutureWatcher<Parsed>::finished, this, &JsonImport::onParsed);
+        QObject::connect(&progress_, &QProgressDialog::canceled,       this, &JsonImport::onCanceled);
+    }
+
+
+    JsonImport::~JsonImport()
+    {
+        loader_.reset(); // before its scene: an interrupted loader ends the bulk update of the scene
+        for (auto const& pipeline : pipelines_)
+        {
+            delete pipeline.editor;
+        }
+    }
+
+
+    void JsonImport::start()
+    {
+        progress_.open(); // shown at once: the window is blocked from now on
+        watcher_.setFuture(QtConcurrent::run(&JsonImport::parse, filename_));
+    }
+
+
+    JsonImport::Parsed JsonImport::parse(QString const& filename)
+    {
+        // Worker thread: no item nor widget here.
+        Parsed parsed;
+        parsed.loaded = readJsonFile(filename, parsed.project, parsed.errors, true);
+        return parsed;
+    }
+
+
+    void JsonImport::onParsed()
+    {
+        if (canceled_)
+        {
+            deleteLater();
+            return;
+        }
+
+        parsed_ = watcher_.result();
+        if (not parsed_.loaded)
+        {
+            QObject::disconnect(&progress_, nullptr, this, nullptr);
+            progress_.hide();
+            QMessageBox::warning(parent_, tr("Import report"), parsed_.errors.join("\n"));
+            deleteLater();
+            return;
+        }
+
+        int total = 0;
+        for (auto const& pipeline : parsed_.project)
+        {
+            total += pipeline.graph.nodes().size() + pipeline.graph.links().size();
+        }
+        progress_.setLabelText(tr("Creating the pipelines..."));
+        progress_.setRange(0, total);
+        progress_.setValue(0);
+
+        QTimer::singleShot(0, this, &JsonImport::buildSlice);
+    }
+
+
+    void JsonImport::buildSlice()
+    {
+        if (canceled_)
+        {
+            return;
+        }
+
+        QElapsedTimer clock;
+        clock.start();
+        while (clock.elapsed() < sliceDuration)
+        {
+            if (loader_ == nullptr)
+            {
+                if (pipelines_.size() == parsed_.project.size())
+                {
+                    // Done: hand the editors over.
+                    QObject::disconnect(&progress_, nullptr, this, nullptr);
+                    progress_.hide();
+
+                    QVector<ImportedPipeline> pipelines;
+                    pipelines.swap(pipelines_);
+                    emit imported(pipelines, parsed_.errors);
+                    deleteLater();
+                    return;
+                }
+
+                Pipeline const& pipeline = parsed_.project.at(pipelines_.size());
+                EditorWidget* editor = new EditorWidget();
+                pipelines_.append({pipeline.name, editor});
+                loader_.reset(new SceneLoader(editor->scene(), pipeline.graph));
+            }
+
+            if (loader_->step(batchSize))
+            {
+                created_ += loader_->total();
+                loader_.reset();
+            }
+        }
+
+        // Note: a modal progress dialog processes the events here, the import may be canceled meanwhile.
+        progress_.setValue(created_ + ((loader_ != nullptr) ? loader_->done() : 0));
+        if (not canceled_)
+        {
+            QTimer::singleShot(0, this, &JsonImport::buildSlice);
+        }
+    }
+
+
+    void JsonImport::onCanceled()
+    {
+        canceled_ = true;
+        loader_.reset();
+        for (auto const& pipeline : pipelines_)
+        {
+            delete pipeline.editor;
+        }
+        pipelines_.clear();
+
+        // A running parse cannot be interrupted: its result is dropped once it ends.
+        if (watcher_.isFinished())
+        {
+            deleteLater();
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PIPER_JSON_IMPORT_H
+#define PIPER_JSON_IMPORT_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QProgressDialog>
+
+#include <memory>
+
+#include "Project.h"
+
+namespace piper
+{
+    class EditorWidget;
+    class SceneLoader;
+
+    // Pipeline built by a JsonImport.
+    struct ImportedPipeline
+    {
+        QString name;
+        EditorWidget* editor;
+    };
+
+    /// \brief Import a JSON project without freezing the editor.
+    /// The file is parsed on a worker thread, then its pipelines are loaded, their links resolved and validated
+    /// concurrently (one task per pipeline, see readJsonFile()), which produces plain Graphs. The items are then
+    /// created on the UI thread by time slices, while a progress dialog allows to cancel. The editors are built out
+    /// of the tabs: a canceled import leaves the project untouched.
+    /// The object deletes itself once done.
+    class JsonImport : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        JsonImport(QString const& filename, QWidget* parent);
+        virtual ~JsonImport();
+
+        void start();
+
+    signals:
+        // Every pipeline is built: the receiver takes the ownership of the editors. File level problems and
+        // validation ones are given with the pipeline name.
+        void imported(QVector<ImportedPipeline> const& pipelines, QStringList const& errors);
+
+    private:
+        // Result of the worker thread.
+        struct Parsed
+        {
+            bool loaded{false};
+            Project project;
+            QStringList errors;
+        };
+        static Parsed parse(QString const& filename);
+
+        void onParsed();
+        void onCanceled();
+
+        // Create items until the time slice is elapsed.
+        void buildSlice();
+
+        QString filename_;
+        QWidget* parent_;
+        QProgressDialog progress_;
+        QFutureWatcher<Parsed> watcher_;
+
+        Parsed parsed_;
+        QVector<ImportedPipeline> pipelines_;
+        std::unique_ptr<SceneLoader> loader_; // loader of the last pipeline of pipelines_
+        int created_{0};                      // items of the pipelines already complete
+        bool canceled_{false};
+    };
+}
+
+#endif
@@ -0,0 +1,288 @@
+#include "JsonStreamExport.h"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocale>
+
+#include <cmath>
+
+namespace piper
+{
+    namespace
+    {
+        QByteArray quoted(QString const& string)
+        {
+            QString escaped;
+            escaped.reserve(string.size() + 2);
+            escaped += '"';
+            for (QChar const c : string)
+            {
+                switch (c.unicode())
+                {
+                    case '"':  { escaped += "\\\""; break; }
+                    case '\\': { escaped += "\\\\"; break; }
+                    case '\b': { escaped += "\\b";  break; }
+                    case '\f': { escaped += "\\f";  break; }
+                    case '\n': { escaped += "\\n";  break; }
+                    case '\r': { escaped += "\\r";  break; }
+                    case '\t': { escaped += "\\t";  break; }
+                    default:
+                    {
+                        if (c.unicode() < 0x20)
+                        {
+                            escaped += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+                        }
+                        else
+                        {
+                            escaped += c;
+                        }
+                    }
+                }
+            }
+            escaped += '"';
+            return escaped.toUtf8();
+        }
+
+        // Same conversion as JsonExport (QJsonValue::fromVariant).
+        QByteArray toJson(QVariant const& data)
+        {
+            QJsonValue const value = QJsonValue::fromVariant(data);
+            switch (value.type())
+            {
+                case QJsonValue::Bool:   { return value.toBool() ? "true" : "false"; }
+                case QJsonValue::String: { return quoted(value.toString()); }
+                case QJsonValue::Double:
+                {
+                    double const number = value.toDouble();
+                    if (not std::isfinite(number))
+                    {
+                        return "null";
+                    }
+                    return QByteArray::number(number, 'g', QLocale::FloatingPointShortest);
+                }
+                case QJsonValue::Array:  { return QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact);  }
+                case QJsonValue::Object: { return QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact); }
+                default:                 { return "null"; }
+            }
+        }
+
+        QByteArray sectionKey(int section)
+        {
+            switch (section)
+            {
+                case 1 << 0: { return "\"Stages\": ["; }
+                case 1 << 1: { return "\"Nodes\": {";  }
+                case 1 << 2: { return "\"Links\": [";  }
+                case 1 << 3: { return "\"Modes\": {";  }
+                default:     { return {};              }
+            }
+        }
+
+        char sectionEnd(int section)
+        {
+            return ((section == (1 << 0)) or (section == (1 << 2))) ? ']' : '}';
+        }
+    }
+
+
+    bool JsonStreamExport::init(QString const& filename)
+    {
+        file_.setFileName(filename);
+        if (not file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qDebug() << "Error while opening" << file_.fileName();
+            return false;
+        }
+
+        first_pipeline_ = true;
+        write("{");
+        return true;
+    }
+
+
+    bool JsonStreamExport::finalize(QString const&)
+    {
+        if (not file_.isOpen())
+        {
+            return false;
+        }
+
+        write("\n}\n");
+        file_.close(); // flush: a write error is kept by the file
+        return file_.error() == QFileDevice::NoError;
+    }
+
+
+    void JsonStreamExport::write(QByteArray const& data)
+    {
+        if (file_.isOpen())
+        {
+            file_.write(data); // QFile is buffered: small writes are merged.
+        }
+    }
+
+
+    void JsonStreamExport::startPipeline(QString const& pipelineName)
+    {
+        write(first_pipeline_ ? "\n    " : ",\n    ");
+        write(quoted(pipelineName) + ": {");
+        first_pipeline_ = false;
+
+        section_ = none;
+        written_sections_ = none;
+    }
+
+
+    void JsonStreamExport::endPipeline(QString const&)
+    {
+        // JsonExport always writes these sections, even empty.
+        for (Section section : {nodes, links, modes})
+        {
+            if (not (written_sections_ & section))
+            {
+                enterSection(section);
+            }
+        }
+        enterSection(none);
+        write("\n    }");
+    }
+
+
+    bool JsonStreamExport::enterSection(Section section)
+    {
+        if (section == section_)
+        {
+            return true;
+        }
+
+        // The section key is already written: a second one would be a duplicated key.
+        if (written_sections_ & section)
+        {
+            qWarning() << "JsonStreamExport: calls of a section shall be grouped. Rejected call of the closed section"
+                       << sectionKey(section);
+            return false;
+        }
+
+        if (section_ != none)
+        {
+            write(first_entry_ ? QByteArray(1, sectionEnd(section_)) : "\n        " + QByteArray(1, sectionEnd(section_)));
+        }
+
+        if (section == none)
+        {
+            section_ = none;
+            return true;
+        }
+
+        write((written_sections_ == none) ? "\n        " : ",\n        ");
+        write(sectionKey(section));
+        section_ = section;
+        written_sections_ |= section;
+        first_entry_ = true;
+        return true;
+    }
+
+
+    void JsonStreamExport::nextEntry()
+    {
+        write(first_entry_ ? "\n            " : ",\n            ");
+        first_entry_ = false;
+    }
+
+
+    void JsonStreamExport::writeStages(QVector<QString> const& stages)
+    {
+        if (not enterSection(Section::stages))
+        {
+            return;
+        }
+        for (auto const& stage : stages)
+        {
+            nextEntry();
+            write(quoted(stage));
+        }
+    }
+
+
+    void JsonStreamExport::writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes)
+    {
+        if (not enterSection(Section::nodes))
+        {
+            return;
+        }
+        nextEntry();
+
+        QByteArray node = quoted(name) + ": {";
+        for (auto it = attributes.constBegin(); it != attributes.constEnd(); ++it)
+        {
+            if (it.key() == "type")  { qWarning() << "type is a reserved attribute. Skipping.";  continue; }
+            if (it.key() == "stage") { qWarning() << "stage is a reserved attribute. Skipping."; continue; }
+            node += quoted(it.key()) + ": " + toJson(it.value()) + ", ";
+        }
+        node += "\"type\": " + quoted(type) + ", \"stage\": " + quoted(stage) + "}";
+        write(node);
+    }
+
+
+    void JsonStreamExport::writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                                     QString const& type, QString const& conversion)
+    {
+        if (not enterSection(Section::links))
+        {
+            return;
+        }
+        nextEntry();
+
+        QByteArray link = "{\"from\": " + quoted(from) + ", \"out\": " + quoted(output)
+                        + ", \"to\": " + quoted(to) + ", \"in\": " + quoted(input) + ", \"type\": " + quoted(type);
+        if (not conversion.isEmpty())
+        {
+            link += ", \"conversion\": " + quoted(conversion);
+        }
+        link += "}";
+        write(link);
+    }
+
+
+    void JsonStreamExport::writeMode(QString const& name, QHash<QString, Mode> const& config)
+    {
+        if (not enterSection(Section::modes))
+        {
+            return;
+        }
+        nextEntry();
+
+        QByteArray mode = quoted(name) + ": {\"default\": \"Enable\", \"configuration\": {";
+        bool first = true;
+        for (auto it = config.constBegin(); it != config.constEnd(); ++it)
+        {
+            QByteArray modeString;
+            switch (it.value())
+            {
+                case Mode::enable:  { continue; }
+                case Mode::disable: { modeString = "\"Disable\""; break; }
+                case Mode::neutral: { modeString = "\"Neutral\""; break; }
+                default: { continue; }
+            }
+
+            mode += (first ? "" : ", ") + quoted(it.key()) + ": " + modeString;
+            first = false;
+        }
+        mode += "}}";
+        write(mode);
+    }
+
+
+    void JsonStreamExport::writeDefaultMode(QString const& name)
+    {
+        if (not enterSection(Section::modes))
+        {
+            return;
+        }
+        nextEntry();
+        write("\"default\": " + quoted(name));
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef PIPER_JSON_STREAM_EXPORT_H
+#define PIPER_JSON_STREAM_EXPORT_H
+
+#include "ExportBackend.h"
+
+#include <QFile>
+
+namespace piper
+{
+    /// \brief Write the same document as JsonExport, but each call is written to the file as it comes: the memory
+    /// used does not depend on the pipeline size.
+    /// Keys are written in call order (JsonExport sorts them). The calls of a section (stages, nodes, links, modes)
+    /// shall be grouped, as Graph::exportGraph() does: a call reopening a closed section is rejected (with a warning).
+    class JsonStreamExport : public ExportBackend
+    {
+    public:
+        JsonStreamExport() = default;
+        virtual ~JsonStreamExport() = default;
+
+        // Open the file.
+        bool init(QString const& filename) override;
+
+        // Close the document and the file.
+        bool finalize(QString const& filename) override;
+
+        void startPipeline(QString const& pipelineName) override;
+        void endPipeline(QString const& pipelineName) override;
+
+        void writeStages(QVector<QString> const& stages) override;
+        void writeNode(QString const& type, QString const& name, QString const& stage, QHash<QString, QVariant> const& attributes) override;
+        void writeLink(QString const& from, QString const& output, QString const& to, QString const& input,
+                       QString const& type, QString const& conversion) override;
+        void writeMode(QString const& name, QHash<QString, Mode> const& config) override;
+        void writeDefaultMode(QString const& name) override;
+
+    private:
+        enum Section
+        {
+            none   = 0,
+            stages = 1 << 0,
+            nodes  = 1 << 1,
+            links  = 1 << 2,
+            modes  = 1 << 3
+        };
+
+        // Close the current section of the pipeline and open the given one (if it is not already the current one).
+        // Return false, without writing anything, if the section was already closed in this pipeline.
+        bool enterSection(Section section);
+
+        // Start a new entry of the current section.
+        void nextEntry();
+
+        void write(QByteArray const& data);
+
+        QFile file_;
+        bool first_pipeline_{true};
+        bool first_entry_{true};
+        Section section_{none};
+        int written_sections_{none};
+    };
+}
+
+#endif
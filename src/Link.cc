@@ -1,12 +1,15 @@
 #include "Link.h"
 #include "Node.h"
 #include "Scene.h"
+#include "Commands.h"
+#include "Profiler.h"
 
 #include <cmath>
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 #include <QKeyEvent>
 #include <QGraphicsRectItem>
+#include <QStyleOptionGraphicsItem>
 
 #include <QDebug>
 
@@ -23,6 +26,9 @@ namespace piper
         selected_.setStyle(Qt::SolidLine);
         selected_.setColor({255, 180, 180, 255}); //TODO theme manager
         selected_.setWidth(3);
+
+        setPen(pen_);
+        setZValue(-1); // force path to be under nodes
     }
 
 
@@ -30,26 +36,41 @@ namespace piper
     {
         disconnect();
         Scene* pScene = static_cast<Scene*>(scene());
-        pScene->removeLink(this);
+        if (pScene != nullptr)
+        {
+            pScene->removeLink(this);
+        }
     }
 
 
     void Link::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
     {
-        if (isSelected())
+        ProfileScope profile{"Link::paint"};
+        if (option->levelOfDetailFromTransform(painter->worldTransform()) < lowDetailLevel)
         {
-            setPen(selected_);
-        }
-        else
-        {
-            setPen(pen_);
+            // Overview: a straight line between the connectors (none before the first updatePath()).
+            QPainterPath const& curve = path();
+            if (curve.isEmpty())
+            {
+                return;
+            }
+            painter->setPen(pen());
+            painter->drawLine(QPointF(curve.elementAt(0)), curve.currentPosition());
+            return;
         }
 
-        if (to_ != nullptr)
+        // The path is cached: it is only recomputed when a connector moves.
+        QGraphicsPathItem::paint(painter, option, widget);
+    }
+
+
+    QVariant Link::itemChange(GraphicsItemChange change, QVariant const& value)
+    {
+        if (change == QGraphicsItem::ItemSelectedHasChanged)
         {
-            updatePath();
+            setPen(value.toBool() ? selected_ : pen_);
         }
-        QGraphicsPathItem::paint(painter, option, widget);
+        return QGraphicsPathItem::itemChange(change, value);
     }
 
 
@@ -70,17 +91,18 @@ namespace piper
 
     void Link::disconnect()
     {
-        if (from_ != nullptr)
-        {
-            from_->disconnect(this);
-            from_ = nullptr;
-        }
-
+        // Input first: it needs the source to unregister the edge.
         if (to_ != nullptr)
         {
             to_->disconnect(this);
             to_ = nullptr;
         }
+
+        if (from_ != nullptr)
+        {
+            from_->disconnect(this);
+            from_ = nullptr;
+        }
     }
 
 
@@ -94,6 +116,13 @@ namespace piper
     }
 
 
+    LinkData Link::endpoints() const
+    {
+        return LinkData{ static_cast<Node*>(from_->parentItem())->name(), from_->name(),
+                         static_cast<Node*>(to_->parentItem())->name(),   to_->name() };
+    }
+
+
     void Link::updatePath()
     {
         updatePath(to_->connectorPos());
@@ -103,13 +132,16 @@ namespace piper
     void Link::updatePath(QPointF const& end)
     {
         updatePath(from_->connectorPos(), end);
-        setZValue(-1); // force path to be under nodes
     }
 
 
     void Link::setColor(QColor const& color)
     {
         pen_.setColor(color);
+        if (not isSelected())
+        {
+            setPen(pen_);
+        }
     }
 
 
@@ -119,6 +151,9 @@ namespace piper
 
         setSelected(true);
 
+        // Save the current connection to record the edit.
+        drag_origin_ = endpoints();
+
         // disconnect from end.
         to_->disconnect(this);
 
@@ -126,10 +161,8 @@ namespace piper
         updatePath(event->scenePos());
 
         // highlight available connections
-        for (auto& node : pScene->nodes())
-        {
-            node->highlight(from_);
-        }
+        pScene->highlightCompatible(from_);
+        setZValue(dimOverlayZ + 1); // keep the dragged link visible
     }
 
 
@@ -145,18 +178,19 @@ namespace piper
         Scene* pScene = static_cast<Scene*>(scene());
 
         // Disable highlight
-        for (auto& node : pScene->nodes())
-        {
-            node->unhighlight();
-        }
+        pScene->clearHighlight();
+        setZValue(-1);
 
         // try to connect to the destinaton.
-        AttributeInput* input = qgraphicsitem_cast<AttributeInput*>(scene()->itemAt(event->scenePos(), QTransform()));
-        if (input != nullptr)
+        AttributeInput* input = pScene->inputAt(event->scenePos());
+        if ((input != nullptr) and input->accept(from_))
         {
-            if (input->accept(from_))
+            connectTo(input);
+
+            LinkData const link = endpoints();
+            if ((link.to != drag_origin_.to) or (link.input != drag_origin_.input))
             {
-                connectTo(input);
+                pScene->undoStack().push(new ConnectCommand(pScene, link, drag_origin_));
             }
         }
         else
@@ -26,9 +26,17 @@ namespace piper
         Attribute const* from() const { return from_; }
         Attribute const* to() const   { return to_;   }
 
+        // Names of the connected nodes and attributes (the link shall be connected).
+        LinkData endpoints() const;
+
+        // Enable the use of qgraphicsitem_cast with this item.
+        enum { Type = UserType + 3 };
+        int type() const override { return Type; }
+
     private:
 
         void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+        QVariant itemChange(GraphicsItemChange change, QVariant const& value) override;
 
         void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
         void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
@@ -46,6 +54,8 @@ namespace piper
 
         Attribute* from_{nullptr};
         Attribute* to_{nullptr};
+
+        LinkData drag_origin_; // connection before the link end is dragged
     };
 }
 
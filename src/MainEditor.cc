@@ -1,11 +1,16 @@
 #include "MainEditor.h"
 #include "ui_MainEditor.h"
 #include "EditorWidget.h"
-#include "JsonExport.h"
+#include "JsonStreamExport.h"
+#include "CborExport.h"
+#include "JsonImport.h"
+#include "Scene.h"
 
+#include <QFile>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
-#include <QJsonParseError>
+#include <QSettings>
 
 namespace piper
 {
@@ -14,6 +19,16 @@ namespace piper
         , ui_(new Ui::MainEditor)
     {
         ui_->setupUi(this);
+
+        QSettings settings("Piper", "editor");
+        undo_max_bytes_   = settings.value("undo/maxBytes",   UndoStack::defaultMaxBytes).toLongLong();
+        undo_max_entries_ = settings.value("undo/maxEntries", UndoStack::defaultMaxEntries).toInt();
+        if ((undo_max_bytes_ <= 0) or (undo_max_entries_ <= 0))
+        {
+            undo_max_bytes_   = UndoStack::defaultMaxBytes;
+            undo_max_entries_ = UndoStack::defaultMaxEntries;
+        }
+
         ui_->editor_tab->createNewEditorTab();
 
         QObject::connect(ui_->actionsave,        &QAction::triggered, this, &MainEditor::onSave);
@@ -22,6 +37,80 @@ namespace piper
         QObject::connect(ui_->actionshowhelp,    &QAction::triggered, this, &MainEditor::onShowHelp);
         QObject::connect(ui_->actionexport_json, &QAction::triggered, this, &MainEditor::onExportJson);
         QObject::connect(ui_->actionimport_json, &QAction::triggered, this, &MainEditor::onImportJson);
+        QObject::connect(ui_->actionexport_cbor, &QAction::triggered, this, &MainEditor::onExportCbor);
+        QObject::connect(ui_->actionimport_cbor, &QAction::triggered, this, &MainEditor::onImportCbor);
+        QObject::connect(ui_->actionundo_limits, &QAction::triggered, this, &MainEditor::onUndoLimits);
+        QObject::connect(ui_->editor_tab, &QTabWidget::currentChanged, this, &MainEditor::onCurrentTabChanged);
+        onCurrentTabChanged(ui_->editor_tab->currentIndex());
+    }
+
+
+    void MainEditor::onCurrentTabChanged(int index)
+    {
+        QObject::disconnect(undo_usage_);
+
+        EditorWidget* editor = ui_->editor_tab->editor(index);
+        if (editor == nullptr)
+        {
+            ui_->statusBar->clearMessage();
+            return;
+        }
+
+        UndoStack* history = &editor->scene()->undoStack();
+        applyUndoLimits(*history);
+        undo_usage_ = QObject::connect(history, &UndoStack::memoryUsageChanged, this,
+            [this, history](qint64 bytes)
+            {
+                showUndoUsage(history->count(), bytes);
+            });
+        showUndoUsage(history->count(), history->memoryUsage());
+    }
+
+
+    void MainEditor::showUndoUsage(int entries, qint64 bytes)
+    {
+        ui_->statusBar->showMessage(tr("Undo history: %1 entries, %2 KiB").arg(entries).arg(bytes / 1024));
+    }
+
+
+    void MainEditor::applyUndoLimits(UndoStack& history)
+    {
+        history.setLimits(undo_max_bytes_, undo_max_entries_);
+    }
+
+
+    void MainEditor::onUndoLimits()
+    {
+        bool ok = false;
+        int const megabytes = QInputDialog::getInt(this, tr("Undo history"), tr("Memory budget per tab (MiB):"),
+                                                   static_cast<int>(undo_max_bytes_ / (1024 * 1024)), 1, 4096, 1, &ok);
+        if (not ok)
+        {
+            return; // nothing to do: user abort.
+        }
+
+        int const entries = QInputDialog::getInt(this, tr("Undo history"), tr("Maximum entries per tab:"),
+                                                 undo_max_entries_, 1, 100000, 1, &ok);
+        if (not ok)
+        {
+            return;
+        }
+
+        undo_max_bytes_   = static_cast<qint64>(megabytes) * 1024 * 1024;
+        undo_max_entries_ = entries;
+
+        QSettings settings("Piper", "editor");
+        settings.setValue("undo/maxBytes",   undo_max_bytes_);
+        settings.setValue("undo/maxEntries", undo_max_entries_);
+
+        // Tabs not built yet get the limits when they become the current one.
+        for (int i = 0; i < ui_->editor_tab->count(); ++i)
+        {
+            if (ui_->editor_tab->pendingEditor(i) == nullptr)
+            {
+                applyUndoLimits(ui_->editor_tab->editor(i)->scene()->undoStack());
+            }
+        }
     }
 
 
@@ -73,22 +162,67 @@ namespace piper
             return; // nothing to do: user abort.
         }
 
-        JsonExport backend;
-        backend.init(filename);
+        JsonStreamExport backend;
+        exportTabs(backend, filename);
+    }
+
+
+    void MainEditor::onExportCbor()
+    {
+        QString filename = QFileDialog::getSaveFileName(this,tr("Export"), "", tr("CBOR (*.cbor);;All Files (*)"));
+        if (filename.isEmpty())
+        {
+            return; // nothing to do: user abort.
+        }
+
+        CborExport backend;
+        exportTabs(backend, filename);
+    }
+
+
+    void MainEditor::exportTabs(ExportBackend& backend, QString const& filename)
+    {
+        if (not backend.init(filename))
+        {
+            QMessageBox::warning(this, tr("Export"), tr("Cannot open %1").arg(filename));
+            return;
+        }
 
         for (int i = 0; i < ui_->editor_tab->count(); ++i)
         {
             QString pipeline = ui_->editor_tab->name(i);
-            backend.startPipeline(pipeline);
 
-            // Export tab content.
-            EditorWidget* editor = static_cast<EditorWidget*>(ui_->editor_tab->widget(i));
-            editor->onExport(backend);
+            // Export tab content. A tab not opened yet is exported from the project file, without building its editor.
+            PendingEditor* pending = ui_->editor_tab->pendingEditor(i);
+            if (pending != nullptr)
+            {
+                Graph graph;
+                QString error;
+                if (not readProjectTab(pending->filename(), pending->entry(), graph, error))
+                {
+                    // An export without this pipeline would be silently incomplete: drop it.
+                    backend.finalize(filename);
+                    QFile::remove(filename);
+                    QMessageBox::warning(this, tr("Export"), error);
+                    return;
+                }
+
+                backend.startPipeline(pipeline);
+                graph.exportGraph(backend);
+            }
+            else
+            {
+                backend.startPipeline(pipeline);
+                ui_->editor_tab->editor(i)->onExport(backend);
+            }
 
             backend.endPipeline(pipeline);
         }
 
-        backend.finalize(filename);
+        if (not backend.finalize(filename))
+        {
+            QMessageBox::warning(this, tr("Export"), tr("Cannot write %1").arg(filename));
+        }
     }
 
 
@@ -104,6 +238,18 @@ namespace piper
     }
 
 
+    void MainEditor::onImportCbor()
+    {
+        QString cborFile = QFileDialog::getOpenFileName(this,tr("Load"), "", tr("Piper CBOR (*.cbor);;All Files (*)"));
+        if (cborFile.isEmpty())
+        {
+            return; // nothing to do: user abort.
+        }
+
+        loadCbor(cborFile);
+    }
+
+
     void MainEditor::onShowHelp()
     {
         QString help;
@@ -111,6 +257,7 @@ namespace piper
         help += "Right click on a node to set its stage and current mode configuration\n";
         help += "Press mouse middle click on an input or output slot to reverse it\n";
         help += "Double click on a mode to set it as  the default one\n";
+        help += "Press F3 to show the profiler, Shift+F3 to save a trace (chrome://tracing)\n";
 
         QMessageBox msgBox;
         msgBox.setText(help);
@@ -120,10 +267,19 @@ namespace piper
 
     void MainEditor::loadProjectFile(const QString& filename)
     {
-        QFile file(filename);
-        file.open(QIODevice::ReadOnly);
-
-        QDataStream in(&file);
+        ProjectIndex index;
+        Project legacy;
+        QString error;
+        bool loaded = readProjectIndex(filename, index, error);
+        if (loaded and (index.version == 1))
+        {
+            loaded = readProjectFile(filename, legacy, error);
+        }
+        if (not loaded)
+        {
+            QMessageBox::warning(this, tr("Load"), error);
+            return;
+        }
 
         // reset editor - clear tabs
         while (ui_->editor_tab->count())
@@ -131,75 +287,136 @@ namespace piper
             ui_->editor_tab->removeTab(ui_->editor_tab->currentIndex());
         }
 
-
-        // load tab
-        int tab_count;
-        in >> tab_count;
-        for (int i = 0; i < tab_count; ++i)
+        // load tab: the legacy format cannot be read partially, its tabs are built now.
+        for (int i = 0; i < legacy.size(); ++i)
         {
             EditorWidget* editor = ui_->editor_tab->createNewEditorTab();
-            QString tab_name;
-            in >> tab_name >> *editor;
-            ui_->editor_tab->setName(i, tab_name);
+            ui_->editor_tab->setName(i, legacy[i].name);
+            editor->scene()->loadGraph(legacy[i].graph);
+        }
+
+        for (auto const& entry : index.tabs)
+        {
+            ui_->editor_tab->createPendingTab(filename, entry);
         }
     }
 
 
     void MainEditor::writeProjectFile(const QString& filename)
     {
-        QFile file(filename);
-        file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        QVector<ProjectTabWriter> tabs;
+        for (int i = 0; i < ui_->editor_tab->count(); ++i)
+        {
+            ProjectTabWriter tab;
+            tab.name = ui_->editor_tab->name(i);
+
+            // A tab not opened yet is copied from its project file without being parsed, unless its content was
+            // written with another stream version: then it is decoded and re-encoded.
+            PendingEditor* pending = ui_->editor_tab->pendingEditor(i);
+            if (pending != nullptr)
+            {
+                tab.write = [pending](QDataStream& out)
+                {
+                    QString error;
+                    if (pending->entry().streamVersion != out.version())
+                    {
+                        Graph graph;
+                        if (not readProjectTab(pending->filename(), pending->entry(), graph, error))
+                        {
+                            qWarning() << error;
+                            out.setStatus(QDataStream::WriteFailed);
+                            return;
+                        }
+                        out << graph;
+                        return;
+                    }
+
+                    QByteArray data;
+                    if (not readProjectTabData(pending->filename(), pending->entry(), data, error))
+                    {
+                        qWarning() << error;
+                        out.setStatus(QDataStream::WriteFailed);
+                        return;
+                    }
+                    out.writeRawData(data.constData(), data.size());
+                };
+            }
+            else
+            {
+                EditorWidget* editor = ui_->editor_tab->editor(i);
+                tab.write = [editor](QDataStream& out) { out << *editor; };
+            }
+            tabs.append(tab);
+        }
 
-        QDataStream out(&file);
+        ProjectIndex index;
+        QString error;
+        if (not writeProjectTabs(filename, tabs, index, error))
+        {
+            QMessageBox::warning(this, tr("Save"), error);
+            return;
+        }
 
-        // Save tab number
-        out << ui_->editor_tab->count();
+        // Pending tabs now refer to the written file.
         for (int i = 0; i < ui_->editor_tab->count(); ++i)
         {
-            // Save tab name.
-            out << ui_->editor_tab->name(i);
-
-            // Save tab content.
-            EditorWidget* editor = static_cast<EditorWidget*>(ui_->editor_tab->widget(i));
-            out << *editor;
+            PendingEditor* pending = ui_->editor_tab->pendingEditor(i);
+            if (pending != nullptr)
+            {
+                pending->relocate(filename, index.tabs[i]);
+            }
         }
     }
 
 
     void MainEditor::loadJson(const QString& filename)
     {
-        QFile file(filename);
-        file.open(QIODevice::ReadOnly | QIODevice::Text);
+        // Parsed on a worker thread, then built by time slices: the editor stays responsive.
+        JsonImport* import = new JsonImport(filename, this);
+        QObject::connect(import, &JsonImport::imported, this,
+            [this](QVector<ImportedPipeline> const& pipelines, QStringList const& errors)
+            {
+                // reset editor - clear tabs
+                while (ui_->editor_tab->count())
+                {
+                    ui_->editor_tab->removeTab(ui_->editor_tab->currentIndex());
+                }
+
+                for (int i = 0; i < pipelines.size(); ++i)
+                {
+                    ui_->editor_tab->addEditorTab(pipelines[i].editor, pipelines[i].name);
+
+                    // File level errors are reported by the first tab.
+                    pipelines[i].editor->endImport((i == 0) ? errors : QStringList{});
+                }
+            });
+        import->start();
+    }
 
-        QByteArray dataJson = file.readAll();
-        file.close();
 
-        QJsonParseError errorPtr;
-        QJsonDocument doc = QJsonDocument::fromJson(dataJson, &errorPtr);
-        if (doc.isNull()) {
-            qDebug() << "Parse failed of " << filename;
+    void MainEditor::loadCbor(QString const& filename)
+    {
+        Project project;
+        QStringList errors;
+        if (not readCborFile(filename, project, errors))
+        {
+            QMessageBox::warning(this, "Import report", errors.join("\n"));
+            return;
         }
 
-        QJsonObject rootObj = doc.object();
-
-        qDebug() << "size " << rootObj.size();
-        qDebug() << rootObj.keys();
-
         // reset editor - clear tabs
         while (ui_->editor_tab->count())
         {
             ui_->editor_tab->removeTab(ui_->editor_tab->currentIndex());
         }
 
-
-        int pipelineNumber = rootObj.size();
-        for (int i = 0; i < pipelineNumber; ++i)
+        for (int i = 0; i < project.size(); ++i)
         {
             EditorWidget* editor = ui_->editor_tab->createNewEditorTab();
-            ui_->editor_tab->setName(i, rootObj.keys()[i]);
+            ui_->editor_tab->setName(i, project[i].name);
 
-            QJsonObject pipelineJson = rootObj[rootObj.keys()[i]].toObject();
-            editor->loadJson(pipelineJson);
+            // File level errors are reported by the first tab.
+            editor->loadGraph(project[i].graph, (i == 0) ? errors : QStringList{});
         }
     }
 }
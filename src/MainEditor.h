@@ -10,6 +10,9 @@ namespace Ui
 
 namespace piper
 {
+    class ExportBackend;
+    class UndoStack;
+
     class MainEditor : public QMainWindow
     {
         Q_OBJECT
@@ -25,14 +28,30 @@ namespace piper
         void onShowHelp();
         void onImportJson();
         void onExportJson();
+        void onImportCbor();
+        void onExportCbor();
+        void onCurrentTabChanged(int index);
+        void onUndoLimits();
 
     private:
         void writeProjectFile(QString const& filename);
         void loadProjectFile(QString const& filename);
         void loadJson(QString const& filename);
+        void loadCbor(QString const& filename);
+
+        // Export every tab through the backend.
+        void exportTabs(ExportBackend& backend, QString const& filename);
+
+        void showUndoUsage(int entries, qint64 bytes);
+
+        // Undo history budget of the tabs: saved in the settings, applied when a tab becomes the current one.
+        void applyUndoLimits(UndoStack& history);
 
         Ui::MainEditor* ui_;
         QString project_filename_;
+        QMetaObject::Connection undo_usage_; // watch the history memory of the current tab
+        qint64 undo_max_bytes_;
+        int undo_max_entries_;
     };
 }
 
@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+#include <limits>
+
+namespace piper
+{
+    MappedFile::~MappedFile()
+    {
+        data_.clear(); // does not own the mapping: release it before the unmap.
+        if (map_ != nullptr)
+        {
+            file_.unmap(map_);
+        }
+    }
+
+
+    bool MappedFile::open(QString const& filename, QString& error)
+    {
+        file_.setFileName(filename);
+        if (not file_.open(QIODevice::ReadOnly))
+        {
+            error = "Cannot open " + filename + ": " + file_.errorString();
+            return false;
+        }
+
+        qint64 const size = file_.size();
+        if (size > std::numeric_limits<int>::max())
+        {
+            error = filename + " is too large";
+            return false;
+        }
+
+        if (size == 0)
+        {
+            return true; // nothing to map
+        }
+
+        map_ = file_.map(0, size);
+        if (map_ != nullptr)
+        {
+            data_ = QByteArray::fromRawData(reinterpret_cast<char const*>(map_), static_cast<int>(size));
+            return true;
+        }
+
+        // Not mappable (pipe, special file system...): fall back on a copy.
+        data_ = file_.readAll();
+        if (data_.size() != size)
+        {
+            error = "Cannot read " + filename + ": " + file_.errorString();
+            return false;
+        }
+        return true;
+    }
+
+
+    QByteArray MappedFile::slice(qint64 offset, qint64 size) const
+    {
+        if ((offset < 0) or (size < 0) or (offset + size > data_.size()))
+        {
+            return {};
+        }
+        return QByteArray::fromRawData(data_.constData() + offset, static_cast<int>(size));
+    }
+}
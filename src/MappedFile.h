@@ -0,0 +1,36 @@
+#ifndef PIPER_MAPPED_FILE_H
+#define PIPER_MAPPED_FILE_H
+
+#include <QByteArray>
+#include <QFile>
+
+namespace piper
+{
+    /// \brief Read-only view of a whole file, parsed in place instead of being copied.
+    /// The file is memory mapped when the platform allows it, and read otherwise. The data are valid while the
+    /// MappedFile lives.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        bool open(QString const& filename, QString& error);
+
+        // Whole file content.
+        QByteArray const& data() const { return data_; }
+
+        // Part of the content (no copy). An out of range request returns a null array.
+        QByteArray slice(qint64 offset, qint64 size) const;
+
+    private:
+        QFile file_;
+        uchar* map_{nullptr};
+        QByteArray data_;
+    };
+}
+
+#endif
@@ -2,11 +2,15 @@
 #include <QTextDocument>
 #include <QGraphicsSceneContextMenuEvent>
 #include <QMenu>
+#include <QStyleOptionGraphicsItem>
 #include <QDebug>
+#include <algorithm>
 
 #include "Node.h"
 #include "Link.h"
 #include "AttributeMember.h"
+#include "Commands.h"
+#include "Profiler.h"
 #include "ThemeManager.h"
 
 namespace piper
@@ -29,6 +33,17 @@ namespace piper
         setPos(-(boundingRect().width() - parentItem()->boundingRect().width()) * 0.5, -boundingRect().height());
     }
 
+    void NodeName::paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget* widget)
+    {
+        ProfileScope profile{"NodeName::paint"};
+        if (option->levelOfDetailFromTransform(painter->worldTransform()) < lowDetailLevel)
+        {
+            return; // unreadable anyway.
+        }
+        QGraphicsTextItem::paint(painter, option, widget);
+    }
+
+
     void NodeName::keyPressEvent(QKeyEvent* e)
     {
         if (e->key() == Qt::Key_Return)
@@ -40,13 +55,23 @@ namespace piper
         // Handle event (text change) and recompute position
         QGraphicsTextItem::keyPressEvent(e);
         adjustPosition();
+        static_cast<Node*>(parentItem())->invalidateLayout();
+    }
+
+
+    void NodeName::focusOutEvent(QFocusEvent* e)
+    {
+        QGraphicsTextItem::focusOutEvent(e);
+
+        // Edition is finished: commit the new name.
+        static_cast<Node*>(parentItem())->onNameEdited();
     }
 
 
     Node::Node(QString const& type, QString const& name, QString const& stage)
         : QGraphicsItem(nullptr)
         , bounding_rect_{0, 0, baseWidth, baseHeight}
-        , name_{new NodeName(this)}
+        , name_item_{new NodeName(this)}
         , type_{type}
         , stage_{stage}
         , mode_{Mode::enable}
@@ -58,9 +83,10 @@ namespace piper
         setFlag(QGraphicsItem::ItemIsMovable);
         setFlag(QGraphicsItem::ItemIsSelectable);
         setFlag(QGraphicsItem::ItemIsFocusable);
+        setFlag(QGraphicsItem::ItemSendsGeometryChanges);
 
         // Configure node name
-        name_->setTextInteractionFlags(Qt::TextEditorInteraction);
+        name_item_->setTextInteractionFlags(Qt::TextEditorInteraction);
         setName(name);
 
         createStyle();
@@ -73,39 +99,9 @@ namespace piper
     Node::~Node()
     {
         Scene* pScene = static_cast<Scene*>(scene());
-        pScene->removeNode(this);
-    }
-
-
-    void Node::highlight(Attribute* emitter)
-    {
-        for (auto& attr : attributes_)
-        {
-            if (attr == emitter)
-            {
-                // special case: do not change emitter mode.
-                continue;
-            }
-
-            if (attr->accept(emitter))
-            {
-                attr->setMode(DisplayMode::highlight);
-            }
-            else
-            {
-                attr->setMode(DisplayMode::minimize);
-            }
-            attr->update();
-        }
-    }
-
-
-    void Node::unhighlight()
-    {
-        for (auto& attr : attributes_)
+        if (pScene != nullptr)
         {
-            attr->setMode(DisplayMode::normal);
-            attr->update();
+            pScene->removeNode(this);
         }
     }
 
@@ -165,57 +161,49 @@ namespace piper
             attr->setPos(1, 17 + attributeHeight * (attributes_.size() + 1));
             if (attributes_.size() % 2)
             {
-                attr->setBackgroundBrush(attribute_brush_);
+                attr->setBackgroundBrush(&style_->attribute_brush);
             }
             else
             {
-                attr->setBackgroundBrush(attribute_alt_brush_);
+                attr->setBackgroundBrush(&style_->attribute_alt_brush);
             }
             height_ += attributeHeight;
             bounding_rect_ = QRectF(0, 0, width_, height_);
             bounding_rect_ += QMargins(1, 1, 1, 1);
             attributes_.append(attr);
+            attributes_index_.insert(qMakePair(static_cast<int>(info.type), info.name), attr);
         }
 
         prepareGeometryChange();
         // readjust name position.
-        name_->adjustPosition();
-
+        name_item_->adjustPosition();
+        invalidateLayout();
     }
 
 
-    void Node::createStyle()
+    Attribute* Node::attribute(QString const& name) const
     {
-        NodeTheme node_theme = ThemeManager::instance().getNodeTheme();
-        AttributeTheme attribute_theme = ThemeManager::instance().getAttributeTheme();
-
-        qint32 border = 2;
-
-        background_brush_.setStyle(Qt::SolidPattern);
-        background_brush_.setColor(node_theme.background);
-
-        pen_.setStyle(Qt::SolidLine);
-        pen_.setWidth(border);
-        pen_.setColor(node_theme.border);
+        for (auto const& attribute : attributes_)
+        {
+            if (attribute->name() == name)
+            {
+                return attribute;
+            }
+        }
+        return nullptr;
+    }
 
-        pen_selected_.setStyle(Qt::SolidLine);
-        pen_selected_.setWidth(border);
-        pen_selected_.setColor(node_theme.border_selected);
 
-        name_->setFont(node_theme.name_font);
-        name_->setDefaultTextColor(node_theme.name_color);
-        name_->adjustPosition();
+    void Node::createStyle()
+    {
+        style_ = ThemeManager::instance().nodeStyle();
+        background_brush_ = style_->background;
 
-        attribute_brush_.setStyle(Qt::SolidPattern);
-        attribute_brush_.setColor(attribute_theme.background);
-        attribute_alt_brush_.setStyle(Qt::SolidPattern);
-        attribute_alt_brush_.setColor(attribute_theme.background_alt);
+        name_item_->setFont(style_->name_font);
+        name_item_->setDefaultTextColor(style_->name_color);
+        name_item_->adjustPosition();
 
-        type_brush_.setStyle(Qt::SolidPattern);
-        type_brush_.setColor(node_theme.type_background);
-        type_pen_.setStyle(Qt::SolidLine);
-        type_pen_.setColor(node_theme.type_color);
-        type_font_ = node_theme.type_font;
+        invalidateLayout();
     }
 
 
@@ -225,42 +213,49 @@ namespace piper
     }
 
 
-    void Node::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
+    void Node::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
     {
+        ProfileScope profile{"Node::paint"};
+        if (option->levelOfDetailFromTransform(painter->worldTransform()) < lowDetailLevel)
+        {
+            // Overview: a flat rectangle in the stage color (attributes, name and forms are not drawn).
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(background_brush_);
+            painter->drawRect(0, 0, width_, height_);
+            return;
+        }
+
         // Base shape.
         painter->setBrush(background_brush_);
 
         if (isSelected())
         {
-            painter->setPen(pen_selected_);
+            painter->setPen(style_->pen_selected);
         }
         else
         {
-            painter->setPen(pen_);
+            painter->setPen(style_->pen);
         }
 
         qint32 radius = 10;
-        type_rect_.setWidth(width_ - 2.0);
         painter->drawRoundedRect(0, 0, width_, height_, radius, radius);
 
         // type background.
-        painter->setBrush(type_brush_);
+        painter->setBrush(style_->type_brush);
         painter->setPen(Qt::NoPen);
         painter->drawRect(type_rect_);
 
         // type label.
-        painter->setFont(type_font_);
-        painter->setPen(type_pen_);
+        painter->setFont(style_->type_font);
+        painter->setPen(style_->type_pen);
         painter->drawText(type_rect_, Qt::AlignCenter, type_);
-
-        updateWidth();
     }
 
 
     void Node::mousePressEvent(QGraphicsSceneMouseEvent* event)
     {
         // Force selected node on top layer
-        for (auto& item : scene()->items())
+        for (auto& item : static_cast<Scene*>(scene())->nodes())
         {
             if (item->zValue() > 1)
             {
@@ -272,29 +267,63 @@ namespace piper
         QGraphicsItem::mousePressEvent(event);
     }
 
-    void Node::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
+    QVariant Node::itemChange(GraphicsItemChange change, QVariant const& value)
     {
-        for (auto& attr : attributes_)
+        if (change == QGraphicsItem::ItemPositionHasChanged)
         {
-            attr->refresh(); // let the attribute refresh their data if required.
+            for (auto& attr : attributes_)
+            {
+                attr->refresh(); // let the attribute refresh their links.
+            }
         }
 
-        QGraphicsItem::mouseMoveEvent(event);
+        return QGraphicsItem::itemChange(change, value);
     }
 
 
-    QString Node::name() const
+    void Node::setName(QString const& name)
     {
-        return name_->toPlainText();
+        QString previous = name_;
+        name_ = name;
+        name_item_->setPlainText(name);
+
+        // Compute position
+        name_item_->adjustPosition();
+        invalidateLayout();
+
+        Scene* pScene = static_cast<Scene*>(scene());
+        if ((pScene != nullptr) and (previous != name))
+        {
+            pScene->onNodeRenamed(this, previous);
+        }
     }
 
 
-    void Node::setName(QString const& name)
+    void Node::onNameEdited()
     {
-        name_->setPlainText(name);
+        QString edited = name_item_->toPlainText();
+        if (edited == name_)
+        {
+            return;
+        }
 
-        // Compute position
-        name_->adjustPosition();
+        Scene* pScene = static_cast<Scene*>(scene());
+        if (edited.isEmpty() or ((pScene != nullptr) and (pScene->findNode(edited) != nullptr)))
+        {
+            // Names shall be unique: revert the edition.
+            name_item_->setPlainText(name_);
+            name_item_->adjustPosition();
+            invalidateLayout();
+            return;
+        }
+
+        QString previous = name_;
+        name_ = edited;
+        if ((pScene != nullptr) and (pScene->findNode(previous) == this)) // the node may be leaving the scene
+        {
+            pScene->onNodeRenamed(this, previous);
+            pScene->undoStack().push(new RenameNodeCommand(pScene, previous, name_));
+        }
     }
 
 
@@ -304,33 +333,49 @@ namespace piper
 
         for (auto& attribute : attributes_)
         {
-            DataTypeTheme theme = ThemeManager::instance().getDataTypeTheme(attribute->dataType());
-
             if (attribute->isOutput())
             {
-                switch (mode)
-                {
-                    case Mode::enable:  { attribute->setColor(theme.enable);  break; }
-                    case Mode::disable: { attribute->setColor(theme.disable); break; }
-                    case Mode::neutral: { attribute->setColor(theme.neutral); break; }
-                }
+                attribute->setNodeMode(mode);
             }
         }
     }
 
-    void Node::updateWidth()
+    void Node::invalidateLayout()
+    {
+        if (layout_dirty_)
+        {
+            return;
+        }
+
+        layout_dirty_ = true;
+        Scene* pScene = static_cast<Scene*>(scene());
+        if (pScene != nullptr)
+        {
+            pScene->scheduleLayout(this);
+        }
+    }
+
+
+    void Node::updateLayout()
     {
-        QList<qreal> widths{name_->sceneBoundingRect().width(), baseWidth};
+        if (not layout_dirty_)
+        {
+            return;
+        }
+        layout_dirty_ = false;
+
+        qreal width = std::max<qreal>(name_item_->boundingRect().width(), baseWidth);
         for (auto& attribute : attributes_)
         {
             if (attribute->isMember())
             {
-                widths.append(attribute->getFormBaseWidth() + attribute->labelRect().right() + 20);
+                width = std::max<qreal>(width, attribute->getFormBaseWidth() + attribute->labelRect().right() + 20);
             }
         }
 
-        std::sort(widths.begin(), widths.end(), std::greater<int>());
-        width_ = static_cast<qint32>(widths[0]);
+        prepareGeometryChange();
+        width_ = static_cast<qint32>(width);
+        type_rect_.setWidth(width_ - 2.0);
         for (auto& attribute : attributes_)
         {
             QRectF rectangle = attribute->boundingRect();
@@ -341,14 +386,16 @@ namespace piper
             attribute->updateConnectorPosition();
         }
         bounding_rect_ = QRectF(0, 0, width_, height_);
-        name_->adjustPosition();
+        name_item_->adjustPosition();
     }
 
+
     void Node::keyPressEvent(QKeyEvent* event)
     {
         if (isSelected())
         {
             constexpr qreal moveFactor = 5;
+            QPointF const origin = pos();
             if ((event->key() == Qt::Key::Key_Up) and (event->modifiers() == Qt::NoModifier))
             {
                 moveBy(0, -moveFactor);
@@ -366,6 +413,12 @@ namespace piper
                 moveBy(moveFactor, 0);
             }
 
+            if (pos() != origin)
+            {
+                Scene* pScene = static_cast<Scene*>(scene());
+                pScene->undoStack().push(new MoveNodesCommand(pScene, {{name(), origin}}, {{name(), pos()}}, true));
+            }
+
             return;
         }
 
@@ -468,52 +521,56 @@ namespace piper
     }
 
 
-    QDataStream& operator<<(QDataStream& out, Node const& node)
+    GraphNode Node::toGraphNode() const
     {
-        // Save node data
-        out << node.type_ << node.name() << node.stage_ << node.pos();
-
-        // save node attributes
-        out << node.attributes().size();
-        for (auto const& attr: node.attributes())
+        GraphNode data{type_, name_, stage_, pos(), {}};
+        data.attributes.reserve(attributes_.size());
+        for (auto const& attribute : attributes_)
         {
-            out << attr->info() << attr->data();
+            data.attributes.append({attribute->info(), attribute->data()});
         }
-
-        return out;
+        return data;
     }
 
 
-    QDataStream& operator>>(QDataStream& in, Node& node)
+    void Node::load(GraphNode const& data)
     {
-        // load node data
-        QPointF pos;
-        QString name;
-        in >> node.type_ >> name >>node.stage_ >> pos;
-        node.setPos(pos);
-        node.setName(name);
-
-        // load node attributes
-        int attributesSize;
-        in >> attributesSize;
+        type_  = data.type;
+        stage_ = data.stage;
+        setPos(data.pos);
+        setName(data.name);
+
         QVector<AttributeInfo> attributesInfo;
-        QVector<QVariant> attributesData;
-        for (int j = 0; j < attributesSize; ++j)
+        attributesInfo.reserve(data.attributes.size());
+        for (auto const& attribute : data.attributes)
         {
-            AttributeInfo info;
-            QVariant data;
-            in >> info >> data;
-            attributesInfo.append(info);
-            attributesData.append(data);
+            attributesInfo.append(attribute.info);
         }
+        createAttributes(attributesInfo);
 
-        node.createAttributes(attributesInfo);
-        auto data = attributesData.constBegin();
-        for (auto const& attribute : node.attributes())
+        for (auto const& attribute : data.attributes)
         {
-            attribute->setData(*data);
-            ++data;
+            Attribute* item = this->attribute(attribute.info.type, attribute.info.name);
+            if (item != nullptr)
+            {
+                item->setData(attribute.data);
+            }
         }
+    }
+
+
+    QDataStream& operator<<(QDataStream& out, Node const& node)
+    {
+        out << node.toGraphNode();
+        return out;
+    }
+
+
+    QDataStream& operator>>(QDataStream& in, Node& node)
+    {
+        GraphNode data;
+        in >> data;
+        node.load(data);
         return in;
     }
 }
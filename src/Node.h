@@ -16,25 +16,21 @@ namespace piper
         void adjustPosition();
 
     protected:
+        void paint(QPainter* painter, QStyleOptionGraphicsItem const* option, QWidget* widget) override;
         void keyPressEvent(QKeyEvent* e) override;
+        void focusOutEvent(QFocusEvent* e) override;
     };
 
     class Node : public QGraphicsItem
     {
         friend Link* connect(QString const& from, QString const& out, QString const& to, QString const& in);
-        friend QDataStream& operator<<(QDataStream& out, Node const& node);
-        friend QDataStream& operator>>(QDataStream& in,  Node& node);
 
     public:
         Node (QString const& type = "", QString const& name = "", QString const& stage = "");
         virtual ~Node();
 
-        // highlight attribute that are compatible with dataType
-        void highlight(Attribute* emitter);
-        void unhighlight();
-
         QString& stage()                { return stage_; } // TODO const it (currently required for stage edition)
-        QString name() const;
+        QString const& name() const     { return name_;  }
         QString const& nodeType() const { return type_;  }
 
         void setMode(Mode mode);
@@ -44,21 +40,46 @@ namespace piper
             background_brush_.setColor(color);
             update();
         }
-        void updateWidth();
+
+        // Geometry (width, attributes and name position) is only computed when something changed.
+        void invalidateLayout();
+        void updateLayout();
 
         // Create attributes of this item.
         void createAttributes(QVector<AttributeInfo> const& attributesInfo);
 
+        // Model of the node (type, name, stage, position and attributes).
+        GraphNode toGraphNode() const;
+
+        // Setup a node without attributes from its model.
+        void load(GraphNode const& data);
+
         QVector<Attribute*> const& attributes() const { return attributes_; }
 
         QVector<Attribute*>& attributes() { return attributes_; }
 
+        // Return the attribute with this direction and name or nullptr (an input and an output may share a name).
+        Attribute* attribute(AttributeInfo::Type type, QString const& name) const
+        {
+            return attributes_index_.value(qMakePair(static_cast<int>(type), name), nullptr);
+        }
+
+        // Return the first attribute with this name (any direction) or nullptr.
+        Attribute* attribute(QString const& name) const;
+
+        // Called when the user finished to edit the node name: the new name is committed if it is unique.
+        void onNameEdited();
+
+        // Enable the use of qgraphicsitem_cast with this item.
+        enum { Type = UserType + 2 };
+        int type() const override { return Type; }
+
     protected:
         QRectF boundingRect() const override;
         void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
 
         void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
-        void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
+        QVariant itemChange(GraphicsItemChange change, QVariant const& value) override;
         void keyPressEvent(QKeyEvent* event) override;
         void contextMenuEvent(QGraphicsSceneContextMenuEvent* event) override;
 
@@ -68,27 +89,22 @@ namespace piper
 
         QRectF bounding_rect_;
 
-        NodeName* name_;
+        NodeName* name_item_;
+        QString name_;      // committed name (the edited text is only applied when the edition ends)
         QString type_;
         QString stage_;
         Mode mode_;
 
         qint32 width_;
         qint32 height_;
+        bool layout_dirty_{true};
 
-        QBrush background_brush_;
-        QPen pen_;
-        QPen pen_selected_;
-
-        QBrush attribute_brush_;
-        QBrush attribute_alt_brush_;
-
-        QPen type_pen_;
-        QBrush type_brush_;
-        QFont type_font_;
+        NodeStyle const* style_{nullptr}; // shared by every node
+        QBrush background_brush_;         // stage color
         QRectF type_rect_;
 
         QVector<Attribute*> attributes_;
+        QHash<QPair<int, QString>, Attribute*> attributes_index_; // (direction, name) -> attribute
     };
 
     Link* connect(QString const& from, QString const& out, QString const& to, QString const& in);
@@ -1,4 +1,6 @@
 #include "NodeCreator.h"
+#include "Node.h"
+#include "DataTypeRegistry.h"
 
 #include <QDebug>
 
@@ -10,6 +12,16 @@ namespace piper
         return creator_;
     }
 
+    Item const* NodeCreator::item(QString const& type) const
+    {
+        auto it = available_items_.constFind(type);
+        if (it == available_items_.constEnd())
+        {
+            return nullptr;
+        }
+        return &it.value();
+    }
+
     void NodeCreator::addItem(Item const& item)
     {
         auto it = available_items_.find(item.type);
@@ -21,6 +33,31 @@ namespace piper
         auto newItem = available_items_.insert(item.type, item);
         if (newItem->from == "")     { newItem->from = "unknown";     }
         if (newItem->category == "") { newItem->category = "unknown"; }
+
+        // Intern data types once: attributes created from this item compare integer ids.
+        for (auto& attribute : newItem->attributes)
+        {
+            attribute.typeId = DataTypeRegistry::instance().intern(attribute.dataType);
+        }
+    }
+
+    void NodeCreator::addConversion(Conversion const& conversion)
+    {
+        DataTypeRegistry& registry = DataTypeRegistry::instance();
+        int const from = registry.intern(conversion.from);
+        int const to   = registry.intern(conversion.to);
+        if (from == to)
+        {
+            qDebug() << "Can't add the conversion. Type" << conversion.from << "is the same on both ends.";
+            return;
+        }
+
+        QString kernel = conversion.kernel;
+        if (kernel.isEmpty())
+        {
+            kernel = QString("cast<%1, %2>").arg(conversion.from, conversion.to);
+        }
+        registry.addConversion(from, to, conversion.cost, kernel);
     }
 
     Node* NodeCreator::createItem(QString const& type, QString const& name, QString const& stage, const QPointF& pos)
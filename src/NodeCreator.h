@@ -1,10 +1,14 @@
 #ifndef PIPER_NODE_CREATOR_H
 #define PIPER_NODE_CREATOR_H
 
-#include "Node.h"
+#include "GraphModel.h"
+
+#include <QList>
 
 namespace piper
 {
+    class Node;
+
     struct Item
     {
         QString type;                       // Item type - shall be unique!
@@ -14,13 +18,28 @@ namespace piper
         QVector<AttributeInfo> attributes;  // Describe the behavior
     };
     
+    struct Conversion
+    {
+        QString from;                       // Output data type
+        QString to;                         // Input data type accepting it
+        int cost;                           // Higher costs are less desirable conversions
+        QString kernel;                     // Runtime operation (default: cast<from, to>)
+    };
+
     class NodeCreator
     {
     public:
         static NodeCreator& instance();
 
         QList<Item> availableItems() const { return available_items_.values(); }
+
+        // Return the registered item of this type or nullptr.
+        Item const* item(QString const& type) const;
+
         void addItem(Item const& item);
+
+        // Allow to connect an output to an input of another data type: the runtime converts the value.
+        void addConversion(Conversion const& conversion);
         Node* createItem(QString const& type, QString const& name, QString const& stage, QPointF const& pos);
 
     private:
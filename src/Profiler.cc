@@ -0,0 +1,106 @@
+#include "Profiler.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+namespace piper
+{
+    Profiler& Profiler::instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+
+    Profiler::Profiler()
+    {
+        clock_.start();
+    }
+
+
+    void Profiler::setEnabled(bool enabled)
+    {
+        enabled_ = enabled;
+        current_frame_.clear();
+    }
+
+
+    void Profiler::record(char const* name, qint64 start, qint64 duration)
+    {
+        if (events_.size() < maxEvents)
+        {
+            events_.append({name, start, duration});
+        }
+
+        // Literals live for the program duration: no need to copy the key.
+        QByteArray const key = QByteArray::fromRawData(name, qstrlen(name));
+        Stat& stat = current_frame_[key];
+        ++stat.count;
+        stat.total += duration;
+        stat.last = duration;
+        latest_[key] = duration;
+    }
+
+
+    void Profiler::endFrame(qint64 start, qint64 duration)
+    {
+        record("frame", start, duration);
+
+        last_frame_.swap(current_frame_);
+        current_frame_.clear();
+
+        frame_times_.append(duration);
+        if (frame_times_.size() > frameHistory)
+        {
+            frame_times_.remove(0, frame_times_.size() - frameHistory);
+        }
+    }
+
+
+    void Profiler::clear()
+    {
+        events_.clear();
+        current_frame_.clear();
+        last_frame_.clear();
+        latest_.clear();
+        frame_times_.clear();
+    }
+
+
+    bool Profiler::writeTrace(QString const& filename, QString& error) const
+    {
+        QFile file(filename);
+        if (not file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            error = "Cannot open " + filename + ": " + file.errorString();
+            return false;
+        }
+
+        // Complete events ("ph": "X"), timestamps in microseconds.
+        qint64 const pid = QCoreApplication::applicationPid();
+        QTextStream out(&file);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (int i = 0; i < events_.size(); ++i)
+        {
+            Event const& event = events_.at(i);
+            out << "{\"name\":\"" << event.name << "\",\"cat\":\"piper\",\"ph\":\"X\",\"pid\":" << pid
+                << ",\"tid\":0,\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+                << ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3) << "}";
+            if (i + 1 < events_.size())
+            {
+                out << ",";
+            }
+            out << "\n";
+        }
+        out << "]}\n";
+
+        out.flush();
+        if (file.error() != QFile::NoError)
+        {
+            error = "Cannot write " + filename + ": " + file.errorString();
+            return false;
+        }
+        return true;
+    }
+}
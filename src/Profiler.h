@@ -0,0 +1,107 @@
+#ifndef PIPER_PROFILER_H
+#define PIPER_PROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace piper
+{
+    /// \brief Optional instrumentation of the editor: scoped timings (paint, mouse events, highlight...).
+    /// Disabled by default: a disabled scope costs a boolean test. Timings are aggregated per frame for the View HUD
+    /// and kept as events to be dumped in the Chrome trace event format (chrome://tracing, Perfetto).
+    /// The profiler is only used from the GUI thread.
+    class Profiler
+    {
+    public:
+        static constexpr int maxEvents = 1000000;  // recording stops when the trace is full
+        static constexpr int frameHistory = 120;
+
+        struct Stat
+        {
+            int count{0};
+            qint64 total{0};    // ns
+            qint64 last{0};     // ns, duration of the last call
+        };
+
+        static Profiler& instance();
+
+        bool isEnabled() const { return enabled_; }
+        void setEnabled(bool enabled);
+
+        // Time since the profiler creation (ns).
+        qint64 now() const { return clock_.nsecsElapsed(); }
+
+        // Record a finished scope. Name shall be a string literal.
+        void record(char const* name, qint64 start, qint64 duration);
+
+        // Close the current frame: its stats become the last frame ones.
+        void endFrame(qint64 start, qint64 duration);
+
+        QHash<QByteArray, Stat> const& lastFrame() const { return last_frame_; }
+        QVector<qint64> const& frameTimes() const { return frame_times_; }
+
+        // Last duration of a scope, whatever the frame (i.e. for mouse events latency).
+        qint64 lastDuration(char const* name) const { return latest_.value(QByteArray::fromRawData(name, qstrlen(name))); }
+
+        int eventCount() const { return events_.size(); }
+        void clear();
+
+        bool writeTrace(QString const& filename, QString& error) const;
+
+    private:
+        Profiler();
+        virtual ~Profiler() = default;
+
+        struct Event
+        {
+            char const* name;
+            qint64 start;
+            qint64 duration;
+        };
+
+        bool enabled_{false};
+        QElapsedTimer clock_;
+
+        QVector<Event> events_;
+        QHash<QByteArray, Stat> current_frame_;
+        QHash<QByteArray, Stat> last_frame_;
+        QHash<QByteArray, qint64> latest_;
+        QVector<qint64> frame_times_;   // ns, frameHistory last frames
+    };
+
+
+    /// \brief Record the duration of the enclosing scope when the profiler is enabled.
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(char const* name)
+            : name_{name}
+        {
+            if (Profiler::instance().isEnabled())
+            {
+                start_ = Profiler::instance().now();
+            }
+        }
+
+        ~ProfileScope()
+        {
+            if (start_ >= 0)
+            {
+                Profiler& profiler = Profiler::instance();
+                profiler.record(name_, start_, profiler.now() - start_);
+            }
+        }
+
+        ProfileScope(ProfileScope const&) = delete;
+        ProfileScope& operator=(ProfileScope const&) = delete;
+
+    private:
+        char const* name_;
+        qint64 start_{-1};
+    };
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "Project.h"
+#include "ExportBackend.h"
+#include "MappedFile.h"
+
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <functional>
+
+namespace piper
+{
+    namespace
+    {
+        // Legacy stream: tab count then, for each tab, its name and its content.
+        bool readLegacyProject(MappedFile const& file, QString const& filename, Project& project, QString& error)
+        {
+            QDataStream in(file.data());
+
+            int tab_count;
+            in >> tab_count;
+            project.clear();
+            if ((in.status() != QDataStream::Ok) or (tab_count < 0))
+            {
+                error = filename + " is not a Piper project";
+                return false;
+            }
+
+            project.resize(tab_count);
+            for (auto& pipeline : project)
+            {
+                in >> pipeline.name >> pipeline.graph;
+            }
+
+            if (in.status() != QDataStream::Ok)
+            {
+                error = filename + " is truncated or corrupted";
+                return false;
+            }
+            return true;
+        }
+
+
+        bool readIndex(MappedFile const& file, QString const& filename, ProjectIndex& index, QString& error)
+        {
+            QDataStream in(file.data());
+            index = {};
+
+            quint32 magic;
+            in >> magic;
+            if (magic != projectMagic)
+            {
+                index.version = 1;
+                index.streamVersion = in.version();
+                return true;
+            }
+
+            qint32 tab_count;
+            in >> index.version >> index.streamVersion >> tab_count;
+            if ((in.status() != QDataStream::Ok) or (index.version > projectVersion) or (tab_count < 0))
+            {
+                error = filename + ": unsupported project version " + QString::number(index.version);
+                return false;
+            }
+            if ((index.streamVersion <= 0) or (index.streamVersion > QDataStream::Qt_DefaultCompiledVersion))
+            {
+                error = filename + ": unsupported stream version " + QString::number(index.streamVersion);
+                return false;
+            }
+
+            in.setVersion(index.streamVersion);
+            index.tabs.resize(tab_count);
+            for (auto& entry : index.tabs)
+            {
+                in >> entry.name >> entry.offset >> entry.size;
+                entry.streamVersion = index.streamVersion;
+                if ((entry.offset < 0) or (entry.size < 0) or (entry.offset + entry.size > file.data().size()))
+                {
+                    in.setStatus(QDataStream::ReadCorruptData);
+                    break;
+                }
+            }
+
+            if (in.status() != QDataStream::Ok)
+            {
+                error = filename + " is truncated or corrupted";
+                return false;
+            }
+            return true;
+        }
+
+
+        bool readTab(MappedFile const& file, QString const& filename, ProjectEntry const& entry, Graph& graph, QString& error)
+        {
+            QByteArray const content = file.slice(entry.offset, entry.size);
+            if (content.size() != entry.size)
+            {
+                error = filename + " is truncated or corrupted";
+                return false;
+            }
+
+            QDataStream in(content);
+            in.setVersion(entry.streamVersion);
+            in >> graph;
+
+            if ((in.status() != QDataStream::Ok) or (not in.atEnd()))
+            {
+                error = filename + ": content of " + entry.name + " is truncated or corrupted";
+                return false;
+            }
+            return true;
+        }
+    }
+
+
+    bool readProjectIndex(QString const& filename, ProjectIndex& index, QString& error)
+    {
+        MappedFile file;
+        return file.open(filename, error) and readIndex(file, filename, index, error);
+    }
+
+
+    bool readProjectTabData(QString const& filename, ProjectEntry const& entry, QByteArray& data, QString& error)
+    {
+        MappedFile file;
+        if (not file.open(filename, error))
+        {
+            return false;
+        }
+
+        QByteArray const content = file.slice(entry.offset, entry.size);
+        if (content.size() != entry.size)
+        {
+            error = filename + " is truncated or corrupted";
+            return false;
+        }
+
+        data = QByteArray(content.constData(), content.size()); // deep copy: the mapping is released on return
+        return true;
+    }
+
+
+    bool readProjectTab(QString const& filename, ProjectEntry const& entry, Graph& graph, QString& error)
+    {
+        MappedFile file;
+        return file.open(filename, error) and readTab(file, filename, entry, graph, error);
+    }
+
+
+    bool writeProjectTabs(QString const& filename, QVector<ProjectTabWriter> const& tabs, ProjectIndex& index, QString& error)
+    {
+        QSaveFile file(filename);
+        if (not file.open(QIODevice::WriteOnly))
+        {
+            error = "Cannot open " + filename + ": " + file.errorString();
+            return false;
+        }
+
+        QDataStream out(&file);
+        out.setVersion(projectStreamVersion);
+        out << projectMagic << projectVersion << projectStreamVersion << static_cast<qint32>(tabs.size());
+
+        // Index with placeholder locations: patched once the contents are written.
+        qint64 const index_start = file.pos();
+        for (auto const& tab : tabs)
+        {
+            out << tab.name << qint64{-1} << qint64{0};
+        }
+
+        ProjectIndex written;
+        written.version = projectVersion;
+        written.streamVersion = projectStreamVersion;
+        written.tabs.reserve(tabs.size());
+        for (auto const& tab : tabs)
+        {
+            ProjectEntry entry{tab.name, file.pos(), 0, projectStreamVersion};
+            tab.write(out);
+            entry.size = file.pos() - entry.offset;
+            written.tabs.append(entry);
+        }
+
+        file.seek(index_start);
+        for (auto const& entry : written.tabs)
+        {
+            out << entry.name << entry.offset << entry.size;
+        }
+
+        if ((out.status() != QDataStream::Ok) or (not file.commit()))
+        {
+            error = "Cannot write " + filename + ": " + file.errorString();
+            file.cancelWriting();
+            return false;
+        }
+
+        index = written;
+        return true;
+    }
+
+
+    bool readProjectFile(QString const& filename, Project& project, QString& error)
+    {
+        // The file is mapped once for the index and every tab.
+        MappedFile file;
+        ProjectIndex index;
+        if ((not file.open(filename, error)) or (not readIndex(file, filename, index, error)))
+        {
+            return false;
+        }
+
+        if (index.version == 1)
+        {
+            return readLegacyProject(file, filename, project, error);
+        }
+
+        project.clear();
+        project.resize(index.tabs.size());
+        for (int i = 0; i < index.tabs.size(); ++i)
+        {
+            project[i].name = index.tabs[i].name;
+            if (not readTab(file, filename, index.tabs[i], project[i].graph, error))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    bool writeProjectFile(QString const& filename, Project const& project, QString& error)
+    {
+        QVector<ProjectTabWriter> tabs;
+        tabs.reserve(project.size());
+        for (auto const& pipeline : project)
+        {
+            Graph const* graph = &pipeline.graph;
+            tabs.append({pipeline.name, [graph](QDataStream& out) { out << *graph; }});
+        }
+
+        ProjectIndex index;
+        return writeProjectTabs(filename, tabs, index, error);
+    }
+
+
+    bool readJsonFile(QString const& filename, Project& project, QStringList& errors, bool resolve)
+    {
+        MappedFile file;
+        QString error;
+        if (not file.open(filename, error))
+        {
+            errors.append(error);
+            return false;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(file.data(), &parseError);
+        if (doc.isNull())
+        {
+            errors.append("Parse failed of " + filename + ": " + parseError.errorString());
+            return false;
+        }
+
+        // One task per pipeline: the document parse is sequential, the pipelines loading is not.
+        QJsonObject const root = doc.object();
+        struct Loaded
+        {
+            Pipeline pipeline;
+            QStringList errors;
+        };
+        QList<Loaded> const loaded = QtConcurrent::blockingMapped<QList<Loaded>>(root.keys(),
+            std::function<Loaded(QString const&)>([&root, resolve](QString const& name)
+            {
+                Loaded result;
+                result.pipeline.name = name;
+
+                Graph& graph = result.pipeline.graph;
+                QStringList problems;
+                graph.loadJson(root.value(name).toObject(), problems);
+                graph.placeNodesByStage({0, 0});
+                if (resolve)
+                {
+                    problems += graph.resolveLinks();
+                    problems += graph.validate();
+                }
+
+                for (auto const& problem : problems)
+                {
+                    result.errors.append(name + ": " + problem);
+                }
+                return result;
+            }));
+
+        project.clear();
+        project.reserve(loaded.size());
+        for (auto const& result : loaded)
+        {
+            project.append(result.pipeline);
+            errors += result.errors;
+        }
+        return true;
+    }
+
+
+    bool exportProject(Project const& project, ExportBackend& backend, QString const& filename)
+    {
+        if (not backend.init(filename))
+        {
+            return false;
+        }
+
+        for (auto const& pipeline : project)
+        {
+            backend.startPipeline(pipeline.name);
+            pipeline.graph.exportGraph(backend);
+            backend.endPipeline(pipeline.name);
+        }
+        return backend.finalize(filename);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef PIPER_PROJECT_H
+#define PIPER_PROJECT_H
+
+#include "GraphModel.h"
+
+#include <functional>
+
+namespace piper
+{
+    class ExportBackend;
+
+    // A named pipeline: one editor tab.
+    struct Pipeline
+    {
+        QString name;
+        Graph graph;
+    };
+
+    // Pipelines of a project, in tab order.
+    using Project = QVector<Pipeline>;
+
+    /// Project file (.piper), version 2:
+    ///   header:  magic "PIPR" (quint32), format version (qint32), QDataStream version (qint32), tab count (qint32)
+    ///   index:   for each tab, its name (QString), the offset (qint64) and the size (qint64) of its content
+    ///   content: for each tab, its Graph stream
+    /// The index allows to read a single tab without parsing the others.
+    /// Version 1 (legacy) has no header nor index: tab count (int) then, for each tab, its name and its Graph stream.
+    constexpr quint32 projectMagic = 0x50495052; // "PIPR"
+    constexpr qint32 projectVersion = 2;
+    constexpr qint32 projectStreamVersion = QDataStream::Qt_5_12;
+
+    // Location of a tab content in a project file.
+    struct ProjectEntry
+    {
+        QString name;
+        qint64 offset{-1};
+        qint64 size{0};
+        qint32 streamVersion{projectStreamVersion}; // QDataStream version of the content: the one of its file header
+    };
+
+    struct ProjectIndex
+    {
+        qint32 version{0};
+        qint32 streamVersion{0};
+        QVector<ProjectEntry> tabs; // empty for a legacy file: its tabs cannot be located without parsing them
+    };
+
+    // Write a tab content in the project stream.
+    struct ProjectTabWriter
+    {
+        QString name;
+        std::function<void(QDataStream&)> write;
+    };
+
+    // Read the header and the index of a project file.
+    bool readProjectIndex(QString const& filename, ProjectIndex& index, QString& error);
+
+    // Read the content of one tab of a version 2 file: as a Graph or as the raw stream bytes (in entry.streamVersion).
+    bool readProjectTab(QString const& filename, ProjectEntry const& entry, Graph& graph, QString& error);
+    bool readProjectTabData(QString const& filename, ProjectEntry const& entry, QByteArray& data, QString& error);
+
+    // Write a version 2 file. The file is replaced only when everything has been written: tab writers may read the
+    // previous content of the file. On success, index describes the written file.
+    bool writeProjectTabs(QString const& filename, QVector<ProjectTabWriter> const& tabs, ProjectIndex& index, QString& error);
+
+    // Read (any version) or write (version 2) a whole project.
+    bool readProjectFile(QString const& filename, Project& project, QString& error);
+    bool writeProjectFile(QString const& filename, Project const& project, QString& error);
+
+    // JSON import format: one object per pipeline. Nodes are placed by stage. Problems are appended to errors.
+    // Pipelines are loaded concurrently, one task per pipeline on the global thread pool. With resolve, the links
+    // which cannot be created are dropped and the pipelines are validated in the same task.
+    bool readJsonFile(QString const& filename, Project& project, QStringList& errors, bool resolve = false);
+
+    // Export every pipeline through the backend (init, pipelines, finalize). Return false if the output cannot be
+    // written.
+    bool exportProject(Project const& project, ExportBackend& backend, QString const& filename);
+}
+
+#endif
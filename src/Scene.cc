@@ -1,31 +1,96 @@
 #include "Scene.h"
 #include "Node.h"
 #include "Link.h"
+#include "Commands.h"
 #include "ExportBackend.h"
 #include "NodeCreator.h"
 #include "ThemeManager.h"
+#include "DataTypeRegistry.h"
+#include "Profiler.h"
 
 #include <QDebug>
 
 #include <QPainter>
 #include <QBrush>
 #include <QKeyEvent>
+#include <QGraphicsSceneMouseEvent>
 #include <algorithm>
-#include <QJsonArray>
-#include <QMap>
 #include <QMessageBox>
 #include <cmath>
+#include <limits>
 #include <QGraphicsView>
+#include <QPainterPath>
+#include <QTimer>
 
 
 namespace piper
 {
-    QStack<QByteArray> Scene::undoStack_{};
-    QStack<QByteArray> Scene::redoStack_{};
+    namespace
+    {
+        // Zoom factor used to render the background of a zoom bucket.
+        qreal bucketScale(int bucket)
+        {
+            return std::min(std::pow(2.0, bucket / 2.0), 16.0);
+        }
+    }
+
+
+    /// \brief Darken the whole scene except a set of areas, in one paint.
+    class DimOverlay : public QGraphicsItem
+    {
+    public:
+        DimOverlay()
+        {
+            setZValue(dimOverlayZ);
+            setAcceptedMouseButtons(Qt::NoButton);
+            setVisible(false);
+        }
+
+        void cover(QRectF const& area, QVector<QRectF> const& holes)
+        {
+            prepareGeometryChange();
+            area_ = area;
+
+            path_ = QPainterPath();
+            path_.setFillRule(Qt::OddEvenFill); // holes do not overlap: no need for boolean operations.
+            path_.addRect(area);
+            for (auto const& hole : holes)
+            {
+                path_.addRect(hole);
+            }
+            update();
+        }
+
+        // Hide the overlay. Its area is reset: QGraphicsScene::itemsBoundingRect() counts hidden items too.
+        void uncover()
+        {
+            prepareGeometryChange();
+            area_ = QRectF();
+            path_ = QPainterPath();
+            hide();
+        }
+
+        QRectF boundingRect() const override { return area_; }
+        QPainterPath shape() const override  { return {}; } // never grab the mouse nor hide items from itemAt()
+
+    protected:
+        void paint(QPainter* painter, QStyleOptionGraphicsItem const*, QWidget*) override
+        {
+            painter->fillPath(path_, QColor{0, 0, 0, 110});
+        }
+
+    private:
+        QRectF area_;
+        QPainterPath path_;
+    };
+
 
     Scene::Scene (QObject* parent)
         : QGraphicsScene(0, 0, 32000, 32000, parent)
+        , dim_overlay_{new DimOverlay}
     {
+        addItem(dim_overlay_);
+
         // Prepare stage model
         stages_ = new QStandardItemModel(this);
         stages_->insertColumns(0, 1);
@@ -56,28 +121,92 @@ namespace piper
 
     void Scene::drawBackground(QPainter* painter, QRectF const& rect)
     {
-        QBrush brush(Qt::SolidPattern);
-        brush.setColor({40, 40, 40}),
-        painter->fillRect(rect, brush);
+        ProfileScope profile{"Scene::drawBackground"};
+        QColor const background{40, 40, 40};
 
-        QPen pen;
-        pen.setColor({100, 100, 100});
-        pen.setWidth(2);
-        painter->setPen(pen);
+        // Views only apply uniform scaling: m11 is the zoom factor.
+        qreal const scale = painter->worldTransform().m11();
+        int const bucket = (scale > 0) ? qRound(std::log2(scale) * 2) : std::numeric_limits<int>::min();
 
-        constexpr int gridSize = 20;
-        qreal left = int(rect.left()) - (int(rect.left()) % gridSize);
-        qreal top = int(rect.top()) - (int(rect.top()) % gridSize);
-        QVector<QPointF> points;
-        for (qreal x = left; x < rect.right(); x += gridSize)
+        GridTile const& tile = gridTile(bucket, painter->device()->devicePixelRatioF());
+        if (tile.pixmap.isNull())
         {
-            for (qreal y = top; y < rect.bottom(); y += gridSize)
+            // Zoomed out too far: the grid is not visible.
+            painter->fillRect(rect, background);
+            return;
+        }
+
+        // Tiles are aligned on multiples of the period: the dots stay on the grid nodes are snapped to.
+        qreal const period = tile.period;
+        QRectF const source(0, 0, tile.extent, tile.extent);
+        qreal const left = std::floor(rect.left() / period) * period;
+        qreal const top  = std::floor(rect.top()  / period) * period;
+        for (qreal x = left; x < rect.right(); x += period)
+        {
+            for (qreal y = top; y < rect.bottom(); y += period)
             {
-                points.append(QPointF(x,y));
+                painter->drawPixmap(QRectF(x, y, period, period), tile.pixmap, source);
             }
         }
+    }
+
 
-        painter->drawPoints(points.data(), points.size());
+    Scene::GridTile const& Scene::gridTile(int bucket, qreal pixelRatio)
+    {
+        auto it = grid_tiles_.constFind(qMakePair(bucket, pixelRatio));
+        if (it != grid_tiles_.constEnd())
+        {
+            return *it;
+        }
+
+        constexpr int gridSize = 20;            // scene units
+        constexpr qreal minGridSpacing = 10;    // pixels
+        constexpr int tileSize = 256;           // pixels
+        constexpr qreal fadeStart = 0.4;        // zoom factor
+        constexpr qreal fadeEnd = 0.1;          // zoom factor
+
+        GridTile tile;
+        qreal const zoom = bucketScale(bucket);
+        qreal const alpha = std::max(0.0, std::min(1.0, (zoom - fadeEnd) / (fadeStart - fadeEnd)));
+        if (alpha > 0)
+        {
+            // Thin the grid when zooming out to keep a constant density on screen.
+            qreal step = gridSize;
+            while ((step * zoom) < minGridSpacing)
+            {
+                step *= 2;
+            }
+
+            // Device pixels per scene unit: the cell size is not rounded, the period stays a multiple of the step.
+            qreal const resolution = zoom * pixelRatio;
+            qreal const cell  = step * resolution;
+            int const cells   = std::max(1, static_cast<int>(tileSize * pixelRatio / cell));
+            qreal const dot   = std::max(1.0, 2 * resolution);
+
+            tile.period = step * cells;
+            tile.extent = cell * cells;
+            int const size = static_cast<int>(std::ceil(tile.extent));
+            tile.pixmap = QPixmap(size, size);
+            tile.pixmap.fill(QColor{40, 40, 40});
+
+            QPainter painter(&tile.pixmap);
+            QColor color{100, 100, 100};
+            color.setAlphaF(alpha);
+            // Dots on the edges are split between adjacent tiles.
+            for (int i = 0; i <= cells; ++i)
+            {
+                for (int j = 0; j <= cells; ++j)
+                {
+                    painter.fillRect(QRectF(i * cell - dot * 0.5, j * cell - dot * 0.5, dot, dot), color);
+                }
+            }
+        }
+
+        if (grid_tiles_.size() > 8)
+        {
+            grid_tiles_.clear(); // only a few zoom levels are used at a time.
+        }
+        return *grid_tiles_.insert(qMakePair(bucket, pixelRatio), tile);
     }
 
 
@@ -85,13 +214,25 @@ namespace piper
     {
         if (keyEvent->key() == Qt::Key::Key_Delete)
         {
-            QByteArray copiedScene = copyCurrentScene();
-            undoStack_.push(copiedScene);
-            redoStack_ = QStack<QByteArray>();
-
+            QList<Node*> nodes;
+            QList<Link*> links;
             for (auto& item : selectedItems())
             {
-                delete item;
+                if (Node* node = qgraphicsitem_cast<Node*>(item))
+                {
+                    nodes << node;
+                }
+                if (Link* link = qgraphicsitem_cast<Link*>(item))
+                {
+                    links << link;
+                }
+            }
+
+            if (not (nodes.isEmpty() and links.isEmpty()))
+            {
+                UndoCommand* command = new RemoveItemsCommand(this, nodes, links);
+                command->redo();
+                undo_stack_.push(command);
             }
         }
 
@@ -106,112 +247,66 @@ namespace piper
         }
     }
 
-    QByteArray Scene::copyCurrentScene()
-    {
-        QByteArray copyCurrentScene;
-        QDataStream stream(&copyCurrentScene, QIODevice::WriteOnly | QIODevice::Truncate);
-        stream << nodes_.size();
-        for (auto const& node : nodes_)
-        {
-            stream << *node;
-        }
-
-        stream << links_.size();
-        for (auto const& link : links_)
-        {
-            stream << static_cast<Node*>(link->from()->parentItem())->name() << link->from()->name();
-            stream << static_cast<Node*>(link->to()->parentItem())->name()   << link->to()->name();
-        }
-
-        return copyCurrentScene;
-    }
 
-    void Scene::loadSceneFromStack(QStack<QByteArray> stack)
+    void Scene::mousePressEvent(QGraphicsSceneMouseEvent* event)
     {
-        QVector<Node*> deleteNodes = nodes_;
-        for (auto& node : deleteNodes)
-        {
-            delete node;
-        }
+        QGraphicsScene::mousePressEvent(event);
 
-        QVector<Link*> deleteLinks = links_;
-        for (auto& link : deleteLinks)
+        // Save nodes position to record the move when the drag ends.
+        move_origin_.clear();
+        if (event->button() != Qt::LeftButton)
         {
-            delete link;
+            return;
         }
 
-        struct LinkData
+        for (auto& item : selectedItems())
         {
-            QString from;
-            QString output;
-            QString to;
-            QString input;
-        };
+            if (Node* node = qgraphicsitem_cast<Node*>(item))
+            {
+                move_origin_.insert(node->name(), node->pos());
+            }
+        }
+    }
 
-        QByteArray previousScene = stack.top();
-        QDataStream stream(previousScene);
-        QList<Node*> copies;
-        QList<LinkData> links;
 
-        // preload nodes and links
-        int nodeCount;
-        stream >> nodeCount;
-        for (int i = 0; i < nodeCount; ++i)
-        {
-            Node* node = new Node();
-            stream >> *node;
-            copies << node;
-        }
+    void Scene::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
+    {
+        QGraphicsScene::mouseReleaseEvent(event);
 
-        int linkCount;
-        stream >> linkCount;
-        for (int i = 0; i < linkCount; ++i)
+        if (event->button() != Qt::LeftButton)
         {
-            LinkData link;
-            stream >> link.from >> link.output >> link.to >> link.input;
-            links << link;
+            return;
         }
 
-        for (auto const& copy : copies)
+        QHash<QString, QPointF> from;
+        QHash<QString, QPointF> to;
+        for (auto it = move_origin_.constBegin(); it != move_origin_.constEnd(); ++it)
         {
-            addNode(copy);
+            Node* node = findNode(it.key());
+            if ((node != nullptr) and (node->pos() != it.value()))
+            {
+                from.insert(it.key(), it.value());
+                to.insert(it.key(), node->pos());
+            }
         }
+        move_origin_.clear();
 
-        for (auto const& link : links)
+        if (not to.isEmpty())
         {
-            connect(link.from, link.output, link.to, link.input);
+            undo_stack_.push(new MoveNodesCommand(this, from, to));
         }
     }
 
+
     void Scene::undo()
     {
-        if(not undoStack_.empty())
-        {
-            QByteArray currentScene = copyCurrentScene();
-            redoStack_.push(currentScene);
-
-            loadSceneFromStack(undoStack_);
-
-            undoStack_.pop();
-
-            onStageUpdated();
-
-        }
+        undo_stack_.undo();
     }
 
+
     void Scene::redo()
     {
-        if(not redoStack_.empty())
-        {
-            QByteArray currentScene = copyCurrentScene();
-            undoStack_.push(currentScene);
-
-            loadSceneFromStack(redoStack_);
-
-            redoStack_.pop();
-
-            onStageUpdated();
-        }
+        undo_stack_.redo();
     }
 
 
@@ -237,8 +332,35 @@ namespace piper
     }
 
 
+    void Scene::applyStageColor(Node* node)
+    {
+        if (inBulkUpdate())
+        {
+            bulk_stages_dirty_ = true; // every node is colored at the end
+            return;
+        }
+
+        for (int i = 0; i < stages_->rowCount(); ++i)
+        {
+            QStandardItem* stage = stages_->item(i, 0);
+            if (stage->data(Qt::DisplayRole).toString() == node->stage())
+            {
+                node->setBackgroundColor(stage->data(Qt::DecorationRole).value<QColor>());
+                return;
+            }
+        }
+        node->setBackgroundColor(ThemeManager::instance().getNodeTheme().background);
+    }
+
+
     void Scene::onStageUpdated()
     {
+        if (inBulkUpdate())
+        {
+            bulk_stages_dirty_ = true;
+            return;
+        }
+
         int row = 0;
         QModelIndex index = stages_->index(row, 0);
 
@@ -256,29 +378,239 @@ namespace piper
 
 
 
+    void Scene::beginBulkUpdate()
+    {
+        if (bulk_depth_++ > 0)
+        {
+            return;
+        }
+
+        // Items are inserted in a plain list: the BSP tree is rebuilt once, with every item, at the end.
+        bulk_index_method_ = itemIndexMethod();
+        setItemIndexMethod(NoIndex);
+        bulk_stages_dirty_ = false;
+    }
+
+
+    void Scene::endBulkUpdate()
+    {
+        if (--bulk_depth_ > 0)
+        {
+            return;
+        }
+
+        ProfileScope profile{"Scene::endBulkUpdate"};
+        setItemIndexMethod(bulk_index_method_);
+        if (bulk_stages_dirty_)
+        {
+            bulk_stages_dirty_ = false;
+            onStageUpdated();
+        }
+    }
+
+
+    bool Scene::isBulkUpdateWorth(int count) const
+    {
+        constexpr int bulkUpdateThreshold = 256; // items
+
+        return (count >= bulkUpdateThreshold) or (count >= nodes_.size() + links_.size());
+    }
+
+
     void Scene::addNode(Node* node)
     {
         addItem(node);
         nodes_.append(node);
+        nodes_index_.insert(node->name(), node);
+        topological_order_.addNode(node);
+        for (auto const& attribute : node->attributes())
+        {
+            if (attribute->isInput())
+            {
+                inputs_by_type_[attribute->typeId()].insert(attribute);
+            }
+        }
+
+        // Nodes are usually built out of the scene: compute their geometry once, now.
+        node->updateLayout();
     }
 
 
     void Scene::removeNode(Node* node)
     {
+        QString const name = node->name();
+
         // Remove from mode
         for (int i = 0; i < modes_->rowCount(); ++i)
         {
             QStandardItem* mode = modes_->item(i, 0);
             QHash<QString, QVariant> nodeMode = mode->data(Qt::UserRole + 2).toHash();
-            nodeMode.remove(node->name());
-            mode->setData(nodeMode, Qt::UserRole + 2);
+            if (nodeMode.remove(name) > 0)
+            {
+                mode->setData(nodeMode, Qt::UserRole + 2);
+            }
         }
 
+        auto it = nodes_index_.find(name);
+        if ((it != nodes_index_.end()) and (it.value() == node))
+        {
+            nodes_index_.erase(it);
+        }
+
+        for (auto const& attribute : node->attributes())
+        {
+            if (attribute->isInput())
+            {
+                inputs_by_type_[attribute->typeId()].remove(attribute);
+            }
+            highlighted_.removeAll(attribute);
+        }
+
+        topological_order_.removeNode(node);
+        pending_layouts_.remove(node);
         removeItem(node);
         nodes_.removeAll(node);
     }
 
 
+    void Scene::scheduleLayout(Node* node)
+    {
+        pending_layouts_.insert(node);
+        schedulePendingUpdates();
+    }
+
+
+    void Scene::scheduleLinkUpdate(Link* link)
+    {
+        pending_links_.insert(link);
+        schedulePendingUpdates();
+    }
+
+
+    void Scene::schedulePendingUpdates()
+    {
+        if (updates_scheduled_)
+        {
+            return;
+        }
+
+        updates_scheduled_ = true;
+        QTimer::singleShot(0, this, &Scene::processPendingUpdates);
+    }
+
+
+    void Scene::processPendingUpdates()
+    {
+        ProfileScope profile{"Scene::processPendingUpdates"};
+        QSet<Node*> layouts;
+        layouts.swap(pending_layouts_);
+        for (auto& node : layouts)
+        {
+            node->updateLayout();
+        }
+
+        // Layouts may move connectors: process links last.
+        QSet<Link*> links;
+        links.swap(pending_links_);
+        for (auto& link : links)
+        {
+            if (link->isConnected())
+            {
+                link->updatePath();
+            }
+        }
+
+        updates_scheduled_ = false;
+    }
+
+
+    void Scene::onNodeRenamed(Node* node, QString const& previous)
+    {
+        QString const name = node->name();
+
+        auto it = nodes_index_.find(previous);
+        if ((it != nodes_index_.end()) and (it.value() == node))
+        {
+            nodes_index_.erase(it);
+        }
+        nodes_index_.insert(name, node);
+
+        // Mode configurations are saved by node name.
+        for (int i = 0; i < modes_->rowCount(); ++i)
+        {
+            QStandardItem* mode = modes_->item(i, 0);
+            QHash<QString, QVariant> nodeMode = mode->data(Qt::UserRole + 2).toHash();
+            auto config = nodeMode.find(previous);
+            if (config == nodeMode.end())
+            {
+                continue;
+            }
+
+            QVariant value = config.value();
+            nodeMode.erase(config);
+            nodeMode.insert(name, value);
+            mode->setData(nodeMode, Qt::UserRole + 2);
+        }
+
+        emit nodeRenamed(previous, name);
+    }
+
+
+    void Scene::highlightCompatible(Attribute* emitter)
+    {
+        ProfileScope profile{"Scene::highlightCompatible"};
+        clearHighlight();
+
+        // Connecting the emitter to one of its ancestors would create a cycle: find them once for all the inputs.
+        QSet<Node*> const ancestors = topological_order_.ancestors(static_cast<Node*>(emitter->parentItem()));
+
+        QVector<QRectF> holes{emitter->sceneBoundingRect()};
+        for (int type : DataTypeRegistry::instance().compatibleTypes(emitter->typeId()))
+        {
+            for (auto const& input : inputs_by_type_.value(type))
+            {
+                if ((not ancestors.contains(static_cast<Node*>(input->parentItem())))
+                    and static_cast<AttributeInput*>(input)->isConnectable(emitter))
+                {
+                    input->setMode(DisplayMode::highlight);
+                    input->update();
+                    highlighted_.append(input);
+                    holes.append(input->sceneBoundingRect());
+                }
+            }
+        }
+
+        dim_overlay_->cover(sceneRect(), holes);
+        dim_overlay_->show();
+    }
+
+
+    void Scene::clearHighlight()
+    {
+        for (auto const& attribute : highlighted_)
+        {
+            attribute->setMode(DisplayMode::normal);
+            attribute->update();
+        }
+        highlighted_.clear();
+        dim_overlay_->uncover();
+    }
+
+
+    AttributeInput* Scene::inputAt(QPointF const& pos) const
+    {
+        for (auto const& item : items(pos))
+        {
+            Attribute* attribute = qgraphicsitem_cast<Attribute*>(item);
+            if ((attribute != nullptr) and attribute->isInput())
+            {
+                return static_cast<AttributeInput*>(attribute);
+            }
+        }
+        return nullptr;
+    }
+
+
     void Scene::addLink(Link* link)
     {
         addItem(link);
@@ -288,53 +620,60 @@ namespace piper
 
     void Scene::removeLink(Link* link)
     {
+        pending_links_.remove(link);
         removeItem(link);
         links_.removeAll(link);
     }
 
 
+    Link* Scene::findLink(LinkData const& link) const
+    {
+        Node const* from = findNode(link.from);
+        if (from == nullptr)
+        {
+            return nullptr;
+        }
+
+        Attribute const* output = from->attribute(AttributeInfo::Type::output, link.output);
+        if (output == nullptr)
+        {
+            return nullptr;
+        }
+
+        for (auto const& candidate : output->links())
+        {
+            Attribute const* to = candidate->to();
+            if ((to != nullptr) and (to->name() == link.input)
+                and (static_cast<Node const*>(to->parentItem())->name() == link.to))
+            {
+                return candidate;
+            }
+        }
+        return nullptr;
+    }
+
+
     void Scene::connect(QString const& from, QString const& out, QString const& to, QString const& in)
     {
-        auto const nodeFrom = std::find_if(nodes().begin(), nodes().end(),
-            [&](Node const* node) { return (node->name() == from); }
-        );
-        auto const nodeTo = std::find_if(nodes().begin(), nodes().end(),
-            [&](Node const* node) { return (node->name() == to); }
-        );
+        Node* nodeFrom = findNode(from);
+        Node* nodeTo   = findNode(to);
 
-        if (nodeFrom == nodes().end())
+        if (nodeFrom == nullptr)
         {
             QString error = "Node " + from + " (from) not found";
             links_import_errors_.append(error);
             return;
         }
 
-        if (nodeTo == nodes().end())
+        if (nodeTo == nullptr)
         {
             QString error = "Node " + to + " (to) not found";
             links_import_errors_.append(error);
             return;
         }
 
-        Attribute* attrOut{nullptr};
-        for (auto& attr : (*nodeFrom)->attributes())
-        {
-            if (attr->isOutput() and (attr->name() == out))
-            {
-                attrOut = attr;
-                break;
-            }
-        }
-
-        Attribute* attrIn{nullptr};
-        for (auto& attr : (*nodeTo)->attributes())
-        {
-            if (attr->isInput() and (attr->name() == in))
-            {
-                attrIn = attr;
-                break;
-            }
-        }
+        Attribute* attrOut = nodeFrom->attribute(AttributeInfo::Type::output, out);
+        Attribute* attrIn  = nodeTo->attribute(AttributeInfo::Type::input, in);
 
         if (attrIn == nullptr)
         {
@@ -353,6 +692,11 @@ namespace piper
         if (not attrIn->accept(attrOut))
         {
             QString error = "Cannot connect node " + from + " to node " + to + ". Type mismatch";
+            if (topological_order_.createsCycle(nodeFrom, nodeTo))
+            {
+                error = "Cannot connect node " + from + " to node " + to + ". It would create a cycle";
+            }
+            links_import_errors_.append(error);
             return;
         }
 
@@ -363,6 +707,53 @@ namespace piper
     }
 
 
+    QHash<QString, QVariant> Scene::nodeModes(QString const& node) const
+    {
+        QHash<QString, QVariant> modes;
+        for (int i = 0; i < modes_->rowCount(); ++i)
+        {
+            QStandardItem* mode = modes_->item(i, 0);
+            QHash<QString, QVariant> nodeMode = mode->data(Qt::UserRole + 2).toHash();
+            auto it = nodeMode.constFind(node);
+            if (it != nodeMode.constEnd())
+            {
+                modes.insert(mode->data(Qt::DisplayRole).toString(), it.value());
+            }
+        }
+        return modes;
+    }
+
+
+    void Scene::restoreNodeModes(QString const& node, QHash<QString, QVariant> const& modes)
+    {
+        if (modes.isEmpty())
+        {
+            return;
+        }
+
+        Node* item = findNode(node);
+        for (int i = 0; i < modes_->rowCount(); ++i)
+        {
+            QStandardItem* mode = modes_->item(i, 0);
+            auto it = modes.constFind(mode->data(Qt::DisplayRole).toString());
+            if (it == modes.constEnd())
+            {
+                continue;
+            }
+
+            QHash<QString, QVariant> nodeMode = mode->data(Qt::UserRole + 2).toHash();
+            nodeMode[node] = it.value();
+            mode->setData(nodeMode, Qt::UserRole + 2);
+
+            // Refresh display if the mode is the current one.
+            if ((item != nullptr) and mode->data(Qt::UserRole + 1).toBool())
+            {
+                item->setMode(static_cast<enum Mode>(it.value().toInt()));
+            }
+        }
+    }
+
+
     QModelIndex Scene::addMode(QString const& name)
     {
         // Add item
@@ -378,60 +769,216 @@ namespace piper
     }
 
 
+    Graph Scene::toGraph() const
+    {
+        Graph graph;
+
+        for (int i = 0; i < stages_->rowCount(); ++i)
+        {
+            QStandardItem const* stage = stages_->item(i, 0);
+            graph.addStage({stage->data(Qt::DisplayRole).toString(), stage->data(Qt::DecorationRole).value<QColor>()});
+        }
+
+        for (int i = 0; i < modes_->rowCount(); ++i)
+        {
+            QStandardItem const* item = modes_->item(i, 0);
+
+            GraphMode mode;
+            mode.name = item->data(Qt::DisplayRole).toString();
+            mode.isDefault = item->data(Qt::DecorationRole).isValid();
+            mode.isSelected = item->data(Qt::UserRole + 1).toBool();
+            QHash<QString, QVariant> config = item->data(Qt::UserRole + 2).toHash();
+            for (auto it = config.constBegin(); it != config.constEnd(); ++it)
+            {
+                mode.nodes.insert(it.key(), static_cast<enum Mode>(it.value().toInt()));
+            }
+            graph.addMode(mode);
+        }
+
+        for (auto const& node : nodes_)
+        {
+            graph.addNode(node->toGraphNode());
+        }
+
+        for (auto const& link : links_)
+        {
+            graph.addLink(link->endpoints());
+        }
+
+        return graph;
+    }
+
+
+    void Scene::loadGraph(Graph const& graph)
+    {
+        SceneLoader loader(this, graph);
+        loader.step(loader.total());
+    }
+
+
+    SceneLoader::SceneLoader(Scene* scene, Graph const& graph)
+        : scene_(scene)
+        , graph_(graph)
+    {
+    }
+
+
+    SceneLoader::~SceneLoader()
+    {
+        if (bulk_ and started_ and not finished_)
+        {
+            scene_->endBulkUpdate(); // interrupted load
+        }
+    }
+
+
+    int SceneLoader::total() const
+    {
+        return graph_.nodes().size() + graph_.links().size();
+    }
+
+
+    bool SceneLoader::step(int count)
+    {
+        if (not started_)
+        {
+            bulk_ = scene_->isBulkUpdateWorth(total());
+            if (bulk_)
+            {
+                scene_->beginBulkUpdate();
+            }
+            for (auto const& stage : graph_.stages())
+            {
+                QStandardItem* item = new QStandardItem();
+                item->setData(stage.color, Qt::DecorationRole);
+                item->setData(stage.name, Qt::DisplayRole);
+                item->setDropEnabled(false);
+                scene_->stages()->appendRow(item);
+            }
+
+            for (auto const& mode : graph_.modes())
+            {
+                QHash<QString, QVariant> config;
+                for (auto it = mode.nodes.constBegin(); it != mode.nodes.constEnd(); ++it)
+                {
+                    config.insert(it.key(), static_cast<int>(it.value()));
+                }
+
+                QStandardItem* item = new QStandardItem();
+                item->setData(mode.name, Qt::DisplayRole);
+                item->setDropEnabled(false);
+                item->setData(mode.isSelected, Qt::UserRole + 1);
+                item->setData(config, Qt::UserRole + 2);
+                if (mode.isDefault)
+                {
+                    item->setData(QIcon(":/icon/star.svg"), Qt::DecorationRole);
+                }
+                scene_->modes()->appendRow(item);
+            }
+            started_ = true;
+        }
+
+        // Nodes first: links refer to them.
+        int const nodes = graph_.nodes().size();
+        int const end = std::min(done_ + count, total());
+        for (; done_ < end; ++done_)
+        {
+            if (done_ < nodes)
+            {
+                GraphNode const& data = graph_.nodes().at(done_);
+                Node* node = new Node();
+                node->load(data);
+
+                Item const* item = NodeCreator::instance().item(data.type);
+                if (item != nullptr)
+                {
+                    node->setToolTip(item->help);
+                }
+                scene_->addNode(node);
+            }
+            else
+            {
+                LinkData const& link = graph_.links().at(done_ - nodes);
+                scene_->connect(link.from, link.output, link.to, link.input);
+            }
+        }
+
+        if (done_ < total())
+        {
+            return false;
+        }
+
+        if (not finished_)
+        {
+            scene_->onStageUpdated();
+            if (bulk_)
+            {
+                scene_->endBulkUpdate();
+            }
+            finished_ = true;
+        }
+        return true;
+    }
+
+
     void Scene::onExport(ExportBackend& backend)
     {
+        // Same calls as Graph::exportGraph(), streamed from the items: the pipeline is not copied (see toGraph()).
         // -------- stages -------- //
-        QVector<QString> stagesArray;
-         for (int i = 0; i < stages()->rowCount(); ++i)
+        QVector<QString> stages;
+        for (int i = 0; i < stages_->rowCount(); ++i)
         {
-            QString stage = stages()->item(i, 0)->data(Qt::DisplayRole).toString();
-            stagesArray.append(stage);
+            stages.append(stages_->item(i, 0)->data(Qt::DisplayRole).toString());
         }
-        backend.writeStages(stagesArray);
+        backend.writeStages(stages);
 
         // -------- nodes -------- //
         for (auto const& node : nodes_)
         {
-            QHash<QString, QVariant> attr;
+            QHash<QString, QVariant> attributes;
             for (auto const& attribute : node->attributes())
             {
-                if (not attribute->isMember())
+                if (attribute->info().type == AttributeInfo::Type::member)
                 {
-                    continue;
+                    attributes.insert(attribute->name(), attribute->data());
                 }
-
-                attr.insert(attribute->name(), attribute->data());
             }
-
-            backend.writeNode(node->nodeType(), node->name(), node->stage(), attr);
+            backend.writeNode(node->nodeType(), node->name(), node->stage(), attributes);
         }
 
         // -------- links -------- //
         for (auto const& link : links_)
         {
-            Node const* from = static_cast<Node const*>(link->from()->parentItem());
-            Node const* to   = static_cast<Node const*>(link->to()->parentItem());
-            backend.writeLink(from->name(), link->from()->name(), to->name(), link->to()->name(), link->from()->dataType());
+            if (not link->isConnected())
+            {
+                continue;
+            }
+
+            Attribute const* output = link->from();
+            Attribute const* input  = link->to();
+            QString const conversion = DataTypeRegistry::instance().conversionKernel(output->typeId(), input->typeId());
+            backend.writeLink(static_cast<Node const*>(output->parentItem())->name(), output->name(),
+                              static_cast<Node const*>(input->parentItem())->name(),  input->name(),
+                              output->dataType(), conversion);
         }
 
         // -------- modes -------- //
-        for (int i = 0; i < modes()->rowCount(); ++i)
+        for (int i = 0; i < modes_->rowCount(); ++i)
         {
-            QStandardItem* mode = modes()->item(i, 0);
-            QString modeName = mode->data(Qt::DisplayRole).toString();
-            if (mode->data(Qt::DecorationRole).isValid())
+            QStandardItem const* item = modes_->item(i, 0);
+            QString const name = item->data(Qt::DisplayRole).toString();
+            if (item->data(Qt::DecorationRole).isValid())
             {
-                backend.writeDefaultMode(modeName);
+                backend.writeDefaultMode(name);
             }
 
-            QHash<QString, QVariant> config = mode->data(Qt::UserRole + 2).toHash();
-            QHash<QString, Mode> exportConfig;
-            for (auto it = config.constBegin(); it != config.constEnd(); ++it)
+            QHash<QString, Mode> config;
+            QHash<QString, QVariant> const modes = item->data(Qt::UserRole + 2).toHash();
+            for (auto it = modes.constBegin(); it != modes.constEnd(); ++it)
             {
-                exportConfig[it.key()] = static_cast<enum Mode>(it.value().toInt());
+                config.insert(it.key(), static_cast<enum Mode>(it.value().toInt()));
             }
-
-            backend.writeMode(modeName, exportConfig);
+            backend.writeMode(name, config);
         }
     }
 
@@ -488,297 +1035,65 @@ namespace piper
 
     QDataStream& operator<<(QDataStream& out, Scene const& scene)
     {
-        // save stages.
-        out << scene.stages()->rowCount();
-        for (int i = 0; i < scene.stages()->rowCount(); ++i)
-        {
-            out << *scene.stages()->item(i, 0);
-        }
-
-        // save modes.
-        out << scene.modes()->rowCount();
-        for (int i = 0; i < scene.modes()->rowCount(); ++i)
-        {
-            out << *scene.modes()->item(i, 0);
-        }
-
-        // save nodes.
-        out << scene.nodes().size();
-        for (auto const& node : scene.nodes())
-        {
-            out << *node;
-        }
-
-        // save links.
-        out << scene.links().size();
-        for (auto const& link : scene.links())
-        {
-            out << static_cast<Node*>(link->from()->parentItem())->name() << link->from()->name();
-            out << static_cast<Node*>(link->to()->parentItem())->name()   << link->to()->name();
-        }
-
+        out << scene.toGraph();
         return out;
     }
 
 
     QDataStream& operator>>(QDataStream& in, Scene& scene)
     {
-        // Load stages.
-        int stageCount;
-        in >> stageCount;
-        for (int i = 0; i < stageCount; ++i)
-        {
-            QStandardItem* item = new QStandardItem();
-            in >> *item;
-            scene.stages()->setItem(i, item);
-        }
-
-        // Load modes.
-        int modeCount;
-        in >> modeCount;
-        for (int i = 0; i < modeCount; ++i)
-        {
-            QStandardItem* item = new QStandardItem();
-            in >> *item;
-            scene.modes()->setItem(i, item);
-        }
-
-        // Load nodes.
-        int nodeCount;
-        in >> nodeCount;
-        for (int i = 0; i < nodeCount; ++i)
-        {
-            Node* node = new Node();
-            in >> *node;
-            scene.addNode(node);
-        }
-
-        // Load links.
-        int linkCount;
-        in >> linkCount;
-        for (int i = 0; i < linkCount; ++i)
-        {
-            QString from, output;
-            in >> from >> output;
-
-            QString to, input;
-            in >> to >> input;
-
-            scene.connect(from, output, to, input);
-        }
-
-        scene.onStageUpdated();
-
+        Graph graph;
+        in >> graph;
+        scene.loadGraph(graph);
         return in;
     }
 
 
     void Scene::onImportJson(QJsonObject& json)
     {
-        // load stages
-        QJsonArray stages= json["Stages"].toArray();
-        for (int i = 0; i < stages.size(); ++i)
-        {
-            QStandardItem* item = new QStandardItem();
-            item->setData(generateRandomColor(), Qt::DecorationRole);
-            item->setData(stages[i].toString(), Qt::DisplayRole);
-            item->setDropEnabled(false);;
-            stages_->appendRow(item);
-        }
-
-        QJsonObject steps = json["Steps"].toObject();
-        loadNodesJson(steps);
-
-        // Organize nodes following their stages.
-        onStageUpdated();
-        placeNodesDefaultPosition();
-
-        QJsonArray links= json["Links"].toArray();
-        loadLinksJson(links);
-
-        QJsonObject modes = json["Modes"].toObject();
-        loadModesJson(modes);
-
-
-        // Display import report if something wrong happened.
-        if (nodes_import_errors_.isEmpty() and links_import_errors_.isEmpty())
-        {
-            return;
-        }
-
-        QString errors;
-        errors += "Nodes:\n";
-        for (auto const& err : nodes_import_errors_) { errors += (err + "\n"); }
-        errors += "Links:\n";
-        for (auto const& err : links_import_errors_) { errors += (err + "\n"); }
-        QMessageBox::warning(nullptr, "Import report", errors);
+        Graph graph;
+        QStringList errors;
+        graph.loadJson(json, errors);
+        onImport(graph, errors);
     }
 
 
-    void Scene::loadNodesJson(QJsonObject& steps)
+    void Scene::onImport(Graph& graph, QStringList const& errors)
     {
-        for (QString stepName : steps.keys())
-        {
-            QJsonObject step = steps[stepName].toObject();
-            QString type = step["type"].toString();
-
-            Node* node = NodeCreator::instance().createItem(type, stepName, "", {0, 0});
-            if (node == nullptr)
-            {
-                QString error = "Cannot create node " + stepName + ": type " + type + " is unknown.";
-                nodes_import_errors_.append(error);
-                continue;
-            }
-
-            for (QString member : step.keys())
-            {
-                if (member == "type")
-                {
-                    continue;
-                }
-                if (member == "stage")
-                {
-                    node->stage() = step["stage"].toString();
-                    continue;
-                }
-
-                QVector<Attribute*>& attributes = node->attributes();
-
-                auto cmp = [&member](Attribute* attr) { return attr->name() == member; };
-
-                auto itObj = std::find_if(attributes.begin(), attributes.end(), cmp);
-                if (itObj != attributes.end())
-                {
-                    (*itObj)->setData(QVariant(step[member].toVariant()));
-                }
-                else
-                {
-                    QString error = "Attribute " + member + " not found: version mismatch ?";
-                    nodes_import_errors_.append(error);
-                }
-            }
-
-            addNode(node);
-        }
-    }
-
-
-    void Scene::loadLinksJson(QJsonArray& links)
-    {
-        for (int i = 0; i < links.size(); ++i)
-        {
-            QJsonObject l = links[i].toObject();
-            QString from = l["from"].toString();
-            QString output = l["out"].toString();
-            QString to = l["to"].toString();
-            QString input = l["in"].toString();
-            connect(from, output, to, input);
-        }
+        // Organize nodes following their stages.
+        graph.placeNodesByStage(defaultPosition());
+        links_import_errors_.clear(); // only report the links of this import
+        loadGraph(graph);
+        reportImport(errors);
     }
 
 
-    void Scene::loadModesJson(QJsonObject& modes)
+    void Scene::reportImport(QStringList const& errors)
     {
-        QString defaultMode;
-        for (auto mode : modes.keys())
+        // Display import report if something wrong happened.
+        if (errors.isEmpty() and links_import_errors_.isEmpty())
         {
-            if (mode == "default")
-            {
-                // special case: the default key define the default mode to use at startup.
-                defaultMode = modes.value(mode).toString();
-                continue;
-            }
-
-            QStandardItem* item = new QStandardItem();
-            item->setData(mode, Qt::DisplayRole);
-            item->setDropEnabled(false);
-
-            // Store mode configuration
-            QHash<QString, QVariant> nodeMode = item->data(Qt::UserRole + 2).toHash();
-            QJsonObject modeObject = modes[mode].toObject();
-            QJsonObject modeConfig = modeObject["configuration"].toObject();
-            for (auto node : modeConfig.keys())
-            {
-                auto fromString = [](QString const& modeIn)
-                {
-                    if (modeIn == "Neutral")
-                    {
-                        return static_cast<int>(Mode::neutral);
-                    }
-                    if (modeIn == "Disable")
-                    {
-                        return static_cast<int>(Mode::disable);
-                    }
-                    return static_cast<int>(Mode::enable);
-                };
-
-                nodeMode[node] = fromString(modeConfig[node].toString());
-            }
-            item->setData(nodeMode, Qt::UserRole + 2);
-
-            modes_->appendRow(item);
+            return;
         }
 
-        // apply default mode value.
-        for (int i = 0; i < modes_->rowCount(); ++i)
-        {
-            QStandardItem* item = modes_->item(i, 0);
-            if (item->data(Qt::DisplayRole).toString() == defaultMode)
-            {
-                onModeSetDefault(modes_->indexFromItem(item));
-                break;
-            }
-        }
+        QString report;
+        report += "Nodes:\n";
+        for (auto const& err : errors) { report += (err + "\n"); }
+        report += "Links:\n";
+        for (auto const& err : links_import_errors_) { report += (err + "\n"); }
+        links_import_errors_.clear(); // reported: the next report shall not repeat them
+        QMessageBox::warning(nullptr, "Import report", report);
     }
 
 
-    void Scene::placeNodesDefaultPosition()
+    QPointF Scene::defaultPosition() const
     {
-        QGraphicsView const* view = views().at(0);
-        QPointF const scenePos = view->mapToScene(view->viewport()->rect().center());
-
-        struct stageInfo {int column; int size;};
-        QMap<QString, stageInfo> stageIndex;
-
-        int row = 0;
-        QModelIndex index = stages_->index(row, 0);
-
-        while (index.isValid())
+        if (views().isEmpty())
         {
-            QString stage = stages_->data(index, Qt::DisplayRole).toString();
-            stageIndex.insert(stage, {row, 0});
-
-            ++row;
-            index = stages_->index(row, 0);
+            return sceneRect().center();
         }
 
-        // Handle steps without stage
-        stageIndex.insert("", {row, 0});
-
-        for (auto n : nodes_)
-        {
-            qreal x = scenePos.x() + 300 * stageIndex[n->stage()].column;
-            qreal y = scenePos.y() + 200 * stageIndex[n->stage()].size;
-
-            stageIndex[n->stage()].size++;
-
-            n->setPos(x ,y);
-            x += 300;
-            y += 150;
-        }
-    }
-
-
-    QColor generateRandomColor()
-    {
-        // procedural color generator: the gold ratio
-        static double nextColorHue = 1.0 / (rand() % 100); // don't need a proper random here
-        constexpr double golden_ratio_conjugate = 0.618033988749895; // 1 / phi
-        nextColorHue += golden_ratio_conjugate;
-        nextColorHue = std::fmod(nextColorHue, 1.0);
-
-        QColor nextColor;
-        nextColor.setHsvF(nextColorHue, 0.5, 0.99);
-        return nextColor;
+        QGraphicsView const* view = views().at(0);
+        return view->mapToScene(view->viewport()->rect().center());
     }
 }
@@ -4,15 +4,26 @@
 #include <QGraphicsScene>
 #include <QStandardItemModel>
 #include <QVector>
+#include <QSet>
+#include <QPixmap>
 #include <QJsonObject>
-#include <QStack>
+
+#include "UndoStack.h"
+#include "TopologicalOrder.h"
+#include "GraphModel.h"
 
 namespace piper
 {
     class Link;
     class Node;
+    class Attribute;
+    class AttributeInput;
+    class DimOverlay;
     class ExportBackend;
 
+    // Z value of the layer that dims the scene during a link drag (the dragged link is drawn above).
+    constexpr qreal dimOverlayZ = 100;
+
     class Scene : public QGraphicsScene
     {
         Q_OBJECT
@@ -23,28 +34,81 @@ namespace piper
 
         void resetStagesColor();
         void updateStagesColor(QString const& stage, QColor const& color);
+        void applyStageColor(Node* node);
+
+        // Bulk insertion (load, paste, undo of a removal): the item index is suspended and the stage colors are
+        // applied once, by endBulkUpdate(). Calls can be nested: the last end applies.
+        void beginBulkUpdate();
+        void endBulkUpdate();
+        bool inBulkUpdate() const { return bulk_depth_ > 0; }
+
+        // Whether inserting count items (nodes and links) is worth a bulk update: its end costs as much as the whole
+        // scene (index rebuild, every node recolored), which only pays off for a large insertion or a (nearly) empty
+        // scene. Otherwise the items are inserted in the index and colored one by one.
+        bool isBulkUpdateWorth(int count) const;
 
         void addNode(Node* node);
         void removeNode(Node* node);
         QVector<Node*> const& nodes() const { return nodes_; }
+        Node* findNode(QString const& name) const { return nodes_index_.value(name, nullptr); }
+
+        // Keep the name based tables (index and modes) up to date.
+        void onNodeRenamed(Node* node, QString const& previous);
+
+        // Defer the node geometry computation to the next event loop iteration (multiple requests are merged).
+        void scheduleLayout(Node* node);
+
+        // Defer the link path computation (i.e. once per drag frame when several nodes move).
+        void scheduleLinkUpdate(Link* link);
+
+        // Link drag feedback: inputs compatible with the emitter are highlighted, the rest of the scene is dimmed.
+        void highlightCompatible(Attribute* emitter);
+        void clearHighlight();
+
+        // Input attribute at the given position (links and overlays are ignored).
+        AttributeInput* inputAt(QPointF const& pos) const;
 
-        QByteArray copyCurrentScene();
-        void loadSceneFromStack(QStack<QByteArray> stack);
+        // Order of the node graph (links are edges): used to keep the pipeline acyclic.
+        TopologicalOrder& topologicalOrder() { return topological_order_; }
+
+        UndoStack& undoStack() { return undo_stack_; }
         void undo();
         void redo();
+
         void addLink(Link* link);
         void removeLink(Link* link);
         QVector<Link*> const& links() const { return links_; }
+        Link* findLink(LinkData const& link) const;
         void connect(QString const& from, QString const& out, QString const& to, QString const& in);
 
+        // Mode configuration of a node: mode name -> node mode.
+        QHash<QString, QVariant> nodeModes(QString const& node) const;
+        void restoreNodeModes(QString const& node, QHash<QString, QVariant> const& modes);
+
         QModelIndex addMode(QString const& name);
 
         QStandardItemModel* stages() const { return stages_; }
         QStandardItemModel* modes()  const { return modes_;  }
 
+        // Model of the scene content: used to save, export and validate the pipeline.
+        Graph toGraph() const;
+
+        // Create the items of the model (the scene is expected to be empty).
+        void loadGraph(Graph const& graph);
+
         void onExport(ExportBackend& backend);
         void onImportJson(QJsonObject& json);
 
+        // Import a pipeline read by an import backend (JSON, CBOR): nodes are placed around the view center.
+        void onImport(Graph& graph, QStringList const& errors);
+
+        // Display the import problems: the given ones and those met while creating the links.
+        void reportImport(QStringList const& errors);
+
+    signals:
+        // Emitted once a node name is committed.
+        void nodeRenamed(QString const& previous, QString const& name);
+
     public slots:
         void onModeSelected(QModelIndex const& index);
         void onModeSetDefault(QModelIndex const& index);
@@ -55,29 +119,84 @@ namespace piper
     protected:
         void drawBackground(QPainter *painter, const QRectF &rect) override;
         void keyReleaseEvent(QKeyEvent *keyEvent) override;
+        void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+        void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
 
     private:
-        void loadNodesJson(QJsonObject& steps);
-        void loadLinksJson(QJsonArray& links);
-        void loadModesJson(QJsonObject& modes);
-        void placeNodesDefaultPosition();
+        // Background grid tile: a square of the scene, period scene units wide, rendered at a given resolution.
+        struct GridTile
+        {
+            QPixmap pixmap;     // null when the grid is not visible
+            qreal period{0};    // scene units: a multiple of the grid step
+            qreal extent{0};    // pixels of the pixmap covering the period (the pixmap size is rounded up)
+        };
+
+        // Background grid tile rendered for a zoom bucket (half octave) and a device pixel ratio.
+        GridTile const& gridTile(int bucket, qreal pixelRatio);
+
+        void schedulePendingUpdates();
+        void processPendingUpdates();
+
+        // Where imported nodes are placed: the center of the view.
+        QPointF defaultPosition() const;
 
         QVector<Node*> nodes_;
+        QHash<QString, Node*> nodes_index_; // name -> node
         QVector<Link*> links_;
 
-        QVector<QString> nodes_import_errors_;
-        QVector<QString> links_import_errors_;
+        QVector<QString> links_import_errors_; // links which cannot be created, since the last import report
 
         QStandardItemModel* stages_;
         QStandardItemModel* modes_;
 
-        static QStack<QByteArray> undoStack_;
-        static QStack<QByteArray> redoStack_;
+        UndoStack undo_stack_;
+        QHash<QString, QPointF> move_origin_; // position of the selected nodes when a drag starts
+
+        QHash<QPair<int, qreal>, GridTile> grid_tiles_; // (bucket, device pixel ratio) -> tile
+
+        TopologicalOrder topological_order_;
+
+        QHash<int, QSet<Attribute*>> inputs_by_type_; // data type id -> input attributes
+        QVector<Attribute*> highlighted_;
+        DimOverlay* dim_overlay_;
+
+        QSet<Node*> pending_layouts_;
+        QSet<Link*> pending_links_;
+        bool updates_scheduled_{false};
+
+        int bulk_depth_{0};
+        ItemIndexMethod bulk_index_method_{BspTreeIndex}; // index method to restore at the end of the bulk update
+        bool bulk_stages_dirty_{false};                   // a stage color update was deferred
+    };
+
+    /// \brief Create the items of a model step by step, to spread a large load over several event loop iterations
+    /// (Scene::loadGraph() creates them in one go). The scene is expected to be empty and the graph to outlive the
+    /// loader.
+    class SceneLoader
+    {
+    public:
+        SceneLoader(Scene* scene, Graph const& graph);
+        ~SceneLoader();
+
+        // Number of items (nodes and links) to create, and already created.
+        int total() const;
+        int done() const { return done_; }
+
+        // Create at most count items (the stages and modes with the first call). Return true once the scene is
+        // complete. The scene stays in a bulk update (if worth it) until then.
+        bool step(int count);
+
+    private:
+        Scene* scene_;
+        Graph const& graph_;
+        int done_{0};
+        bool started_{false};
+        bool finished_{false};
+        bool bulk_{false};
     };
 
     QDataStream& operator<<(QDataStream& out, Scene const& scene);
     QDataStream& operator>>(QDataStream& in,  Scene& scene);
-    QColor generateRandomColor();
 }
 
 #endif
@@ -1,4 +1,5 @@
 #include "ThemeManager.h"
+#include "DataTypeRegistry.h"
 
 #include <QDebug>
 #include <QFile>
@@ -16,6 +17,12 @@ namespace piper
     }
 
 
+    ThemeManager::~ThemeManager()
+    {
+        qDeleteAll(attribute_styles_);
+    }
+
+
     NodeTheme ThemeManager::getNodeTheme() const
     {
         return node_theme_;
@@ -72,10 +79,86 @@ namespace piper
             return false;
         }
 
+        // Update the shared styles once: items only hold a pointer on them.
+        buildNodeStyle();
+        for (int i = 0; i < attribute_styles_.size(); ++i)
+        {
+            if (attribute_styles_.at(i) != nullptr)
+            {
+                buildAttributeStyle(*attribute_styles_.at(i), i / modeCount, static_cast<Mode>(i % modeCount));
+            }
+        }
+
         return true;
     }
 
 
+    AttributeStyle const* ThemeManager::attributeStyle(int typeId, Mode mode)
+    {
+        int const index = typeId * modeCount + mode;
+        if (index >= attribute_styles_.size())
+        {
+            attribute_styles_.resize(index + 1);
+        }
+
+        AttributeStyle*& style = attribute_styles_[index];
+        if (style == nullptr)
+        {
+            style = new AttributeStyle;
+            buildAttributeStyle(*style, typeId, mode);
+        }
+        return style;
+    }
+
+
+    void ThemeManager::buildNodeStyle()
+    {
+        qint32 const border = 2;
+
+        node_style_.name_font  = node_theme_.name_font;
+        node_style_.name_color = node_theme_.name_color;
+
+        node_style_.background = QBrush{node_theme_.background, Qt::SolidPattern};
+        node_style_.pen = QPen{node_theme_.border};
+        node_style_.pen.setWidth(border);
+        node_style_.pen_selected = QPen{node_theme_.border_selected};
+        node_style_.pen_selected.setWidth(border);
+
+        node_style_.attribute_brush     = QBrush{attribute_theme_.background, Qt::SolidPattern};
+        node_style_.attribute_alt_brush = QBrush{attribute_theme_.background_alt, Qt::SolidPattern};
+
+        node_style_.type_font  = node_theme_.type_font;
+        node_style_.type_pen   = QPen{node_theme_.type_color};
+        node_style_.type_brush = QBrush{node_theme_.type_background, Qt::SolidPattern};
+    }
+
+
+    void ThemeManager::buildAttributeStyle(AttributeStyle& style, int typeId, Mode mode)
+    {
+        DataTypeTheme typeTheme = getDataTypeTheme(DataTypeRegistry::instance().name(typeId));
+        QColor color;
+        switch (mode)
+        {
+            case Mode::enable:  { color = typeTheme.enable;  break; }
+            case Mode::disable: { color = typeTheme.disable; break; }
+            case Mode::neutral: { color = typeTheme.neutral; break; }
+        }
+
+        auto buildMode = [&color](AttributeTheme::Mode const& theme, AttributeStyle::Mode& target)
+        {
+            target.font     = theme.font;
+            target.font_pen = QPen{theme.font_color};
+            target.pen      = QPen{theme.connector.border_color};
+            target.pen.setWidth(theme.connector.border_width);
+            target.brush    = QBrush{color, Qt::SolidPattern};
+        };
+
+        buildMode(attribute_theme_.minimize,  style.minimize);
+        buildMode(attribute_theme_.normal,    style.normal);
+        buildMode(attribute_theme_.highlight, style.highlight);
+    }
+
+
     bool ThemeManager::parseNode(QJsonObject const& json)
     {
         if (not (json.contains("node") and json["node"].isObject()))
@@ -4,6 +4,12 @@
 #include <QString>
 #include <QColor>
 #include <QFont>
+#include <QPen>
+#include <QBrush>
+#include <QHash>
+#include <QVector>
+
+#include "Types.h"
 
 namespace piper
 {
@@ -52,6 +58,42 @@ namespace piper
     };
 
 
+    /// \brief Drawing tools shared by every node.
+    struct NodeStyle
+    {
+        QFont name_font;
+        QColor name_color;
+
+        QBrush background;
+        QPen pen;
+        QPen pen_selected;
+
+        QBrush attribute_brush;
+        QBrush attribute_alt_brush;
+
+        QFont type_font;
+        QPen type_pen;
+        QBrush type_brush;
+    };
+
+
+    /// \brief Drawing tools shared by the attributes of a data type in a node mode.
+    struct AttributeStyle
+    {
+        struct Mode
+        {
+            QFont font;
+            QPen font_pen;
+            QPen pen;
+            QBrush brush;
+        };
+
+        Mode minimize;
+        Mode normal;
+        Mode highlight;
+    };
+
+
     class ThemeManager
     {
     public:
@@ -62,8 +104,16 @@ namespace piper
         AttributeTheme getAttributeTheme() const;
         DataTypeTheme getDataTypeTheme(QString const& dataType);
 
+        // Shared styles: they live as long as the manager and are rebuilt in place when a theme is loaded.
+        NodeStyle const* nodeStyle() const { return &node_style_; }
+        AttributeStyle const* attributeStyle(int typeId, Mode mode); // typeId from DataTypeRegistry
+
     private:
         ThemeManager() = default;
+        ~ThemeManager();
+
+        void buildNodeStyle();
+        void buildAttributeStyle(AttributeStyle& style, int typeId, Mode mode);
 
         bool parseNode(QJsonObject const& json);
         bool parseAttribute(QJsonObject const& json);
@@ -74,6 +124,9 @@ namespace piper
         NodeTheme node_theme_;
         AttributeTheme attribute_theme_;
         QHash<QString, DataTypeTheme> data_type_themes_;
+
+        NodeStyle node_style_;
+        QVector<AttributeStyle*> attribute_styles_; // indexed by typeId * modeCount + mode
     };
 }
 
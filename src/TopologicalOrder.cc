@@ -0,0 +1,262 @@
+#include "TopologicalOrder.h"
+
+#include <algorithm>
+
+namespace piper
+{
+    void TopologicalOrder::addNode(Node* node)
+    {
+        if (order_.contains(node))
+        {
+            return;
+        }
+
+        order_.insert(node, positions_.size());
+        positions_.append(node);
+    }
+
+
+    void TopologicalOrder::removeNode(Node* node)
+    {
+        auto it = order_.find(node);
+        if (it == order_.end())
+        {
+            return;
+        }
+
+        QHash<Node*, int> const successors   = successors_.take(node);
+        QHash<Node*, int> const predecessors = predecessors_.take(node);
+        for (auto it = successors.keyBegin(); it != successors.keyEnd(); ++it)
+        {
+            predecessors_[*it].remove(node);
+        }
+        for (auto it = predecessors.keyBegin(); it != predecessors.keyEnd(); ++it)
+        {
+            successors_[*it].remove(node);
+        }
+
+        positions_[it.value()] = nullptr;
+        order_.erase(it);
+        ++free_positions_;
+
+        if (free_positions_ > positions_.size() / 2)
+        {
+            compact();
+        }
+    }
+
+
+    bool TopologicalOrder::addEdge(Node* from, Node* to)
+    {
+        if ((from == to) or (not order_.contains(from)) or (not order_.contains(to)))
+        {
+            return false;
+        }
+
+        int const links = successors_.value(from).value(to, 0);
+        if (links > 0)
+        {
+            // Already ordered.
+            successors_[from][to]   = links + 1;
+            predecessors_[to][from] = links + 1;
+            return true;
+        }
+
+        int const lowerBound = order_.value(to);
+        int const upperBound = order_.value(from);
+        if (lowerBound < upperBound)
+        {
+            // The new edge goes backward: only the nodes placed between its ends shall be reordered.
+            QVector<Node*> forward;
+            if (searchForward(to, upperBound, forward))
+            {
+                return false;
+            }
+
+            QVector<Node*> backward;
+            searchBackward(from, lowerBound, backward);
+            reorder(forward, backward);
+        }
+
+        successors_[from][to]   = 1;
+        predecessors_[to][from] = 1;
+        return true;
+    }
+
+
+    void TopologicalOrder::removeEdge(Node* from, Node* to)
+    {
+        auto successors = successors_.find(from);
+        if (successors == successors_.end())
+        {
+            return;
+        }
+
+        auto links = successors->find(to);
+        if (links == successors->end())
+        {
+            return;
+        }
+
+        // Removing an edge never invalidates the order.
+        if (--links.value() > 0)
+        {
+            predecessors_[to][from] = links.value();
+            return;
+        }
+        successors->erase(links);
+        predecessors_[to].remove(from);
+    }
+
+
+    bool TopologicalOrder::createsCycle(Node* from, Node* to) const
+    {
+        if (from == to)
+        {
+            return true;
+        }
+
+        int const fromOrder = order(from);
+        int const toOrder   = order(to);
+        if ((fromOrder < 0) or (toOrder < 0) or (fromOrder < toOrder))
+        {
+            return false;
+        }
+
+        QVector<Node*> visited;
+        return searchForward(to, fromOrder, visited);
+    }
+
+
+    QSet<Node*> TopologicalOrder::ancestors(Node* node) const
+    {
+        QSet<Node*> visited{node};
+        QVector<Node*> stack{node};
+        while (not stack.isEmpty())
+        {
+            Node* current = stack.takeLast();
+            auto const& predecessors = predecessors_.value(current);
+            for (auto it = predecessors.keyBegin(); it != predecessors.keyEnd(); ++it)
+            {
+                if (not visited.contains(*it))
+                {
+                    visited.insert(*it);
+                    stack.append(*it);
+                }
+            }
+        }
+        return visited;
+    }
+
+
+    QVector<Node*> TopologicalOrder::sorted() const
+    {
+        QVector<Node*> nodes;
+        nodes.reserve(order_.size());
+        for (auto const& node : positions_)
+        {
+            if (node != nullptr)
+            {
+                nodes.append(node);
+            }
+        }
+        return nodes;
+    }
+
+
+    void TopologicalOrder::clear()
+    {
+        order_.clear();
+        positions_.clear();
+        free_positions_ = 0;
+        successors_.clear();
+        predecessors_.clear();
+    }
+
+
+    bool TopologicalOrder::searchForward(Node* start, int upperBound, QVector<Node*>& visited) const
+    {
+        QSet<Node*> seen{start};
+        QVector<Node*> stack{start};
+        visited.append(start);
+        while (not stack.isEmpty())
+        {
+            Node* current = stack.takeLast();
+            auto const& successors = successors_.value(current);
+            for (auto it = successors.keyBegin(); it != successors.keyEnd(); ++it)
+            {
+                int const position = order_.value(*it);
+                if (position == upperBound)
+                {
+                    return true;
+                }
+
+                if ((position < upperBound) and (not seen.contains(*it)))
+                {
+                    seen.insert(*it);
+                    stack.append(*it);
+                    visited.append(*it);
+                }
+            }
+        }
+        return false;
+    }
+
+
+    void TopologicalOrder::searchBackward(Node* start, int lowerBound, QVector<Node*>& visited) const
+    {
+        QSet<Node*> seen{start};
+        QVector<Node*> stack{start};
+        visited.append(start);
+        while (not stack.isEmpty())
+        {
+            Node* current = stack.takeLast();
+            auto const& predecessors = predecessors_.value(current);
+            for (auto it = predecessors.keyBegin(); it != predecessors.keyEnd(); ++it)
+            {
+                if ((order_.value(*it) > lowerBound) and (not seen.contains(*it)))
+                {
+                    seen.insert(*it);
+                    stack.append(*it);
+                    visited.append(*it);
+                }
+            }
+        }
+    }
+
+
+    void TopologicalOrder::reorder(QVector<Node*>& forward, QVector<Node*>& backward)
+    {
+        auto byOrder = [this](Node* lhs, Node* rhs) { return order_.value(lhs) < order_.value(rhs); };
+        std::sort(forward.begin(), forward.end(), byOrder);
+        std::sort(backward.begin(), backward.end(), byOrder);
+
+        // Reuse the positions of the visited nodes: ancestors of 'from' are placed before the descendants of 'to'.
+        QVector<Node*> nodes = backward + forward;
+        QVector<int> positions;
+        positions.reserve(nodes.size());
+        for (auto const& node : nodes)
+        {
+            positions.append(order_.value(node));
+        }
+        std::sort(positions.begin(), positions.end());
+
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            order_[nodes.at(i)] = positions.at(i);
+            positions_[positions.at(i)] = nodes.at(i);
+        }
+    }
+
+
+    void TopologicalOrder::compact()
+    {
+        QVector<Node*> positions = sorted();
+        for (int i = 0; i < positions.size(); ++i)
+        {
+            order_[positions.at(i)] = i;
+        }
+        positions_ = positions;
+        free_positions_ = 0;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PIPER_TOPOLOGICAL_ORDER_H
+#define PIPER_TOPOLOGICAL_ORDER_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+namespace piper
+{
+    class Node;
+
+    /// \brief Topological order of the node graph, maintained incrementally (Pearce-Kelly algorithm).
+    /// Adding an edge only visits the nodes placed between its ends in the current order: the order is kept
+    /// valid in amortized sub-linear time and an edge closing a cycle is detected before it is added.
+    /// Several links between the same nodes are counted as a single edge.
+    class TopologicalOrder
+    {
+    public:
+        TopologicalOrder() = default;
+        virtual ~TopologicalOrder() = default;
+
+        // A new node is placed last.
+        void addNode(Node* node);
+
+        // Remove a node and its edges.
+        void removeNode(Node* node);
+
+        // Return false (and do nothing) when the edge would create a cycle.
+        bool addEdge(Node* from, Node* to);
+        void removeEdge(Node* from, Node* to);
+
+        // True if adding from -> to would create a cycle.
+        bool createsCycle(Node* from, Node* to) const;
+
+        // Nodes that have a path to the given node (the node included).
+        QSet<Node*> ancestors(Node* node) const;
+
+        // Position of the node in the order (-1 if unknown).
+        int order(Node* node) const { return order_.value(node, -1); }
+
+        // Nodes sorted: every node comes after its predecessors.
+        QVector<Node*> sorted() const;
+
+        void clear();
+
+    private:
+        // Forward search from start restricted to nodes placed before upperBound. Return true if the node placed
+        // at upperBound is reached (a cycle).
+        bool searchForward(Node* start, int upperBound, QVector<Node*>& visited) const;
+
+        // Backward search from start restricted to nodes placed after lowerBound.
+        void searchBackward(Node* start, int lowerBound, QVector<Node*>& visited) const;
+
+        // Give the visited nodes their new positions: backward ones first, then forward ones.
+        void reorder(QVector<Node*>& forward, QVector<Node*>& backward);
+
+        // Remove the free positions left by removed nodes.
+        void compact();
+
+        QHash<Node*, int> order_;       // node -> position
+        QVector<Node*> positions_;      // position -> node (nullptr when the node was removed)
+        int free_positions_{0};
+
+        QHash<Node*, QHash<Node*, int>> successors_;    // from -> (to -> number of links)
+        QHash<Node*, QHash<Node*, int>> predecessors_;  // to -> (from -> number of links)
+    };
+}
+
+#endif
@@ -10,6 +10,10 @@ namespace piper
         disable, // The node is disable and shall not interact with the pipeline (dead end)
         neutral  // The node shall interact with the pipeline in a neutral step (i.e. passthrough, add 0, multiply with 1, etc.)
     };
+    constexpr int modeCount = 3;
+
+    // Below this level of detail (i.e. zoom factor), items are drawn as simplified shapes without text nor widgets.
+    constexpr double lowDetailLevel = 0.4;
 }
 
 #endif
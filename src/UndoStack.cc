@@ -0,0 +1,164 @@
+#include "UndoStack.h"
+
+namespace piper
+{
+    constexpr qint64 UndoStack::defaultMaxBytes;
+    constexpr int    UndoStack::defaultMaxEntries;
+    constexpr int    UndoStack::defaultUncompressedEntries;
+
+
+    UndoStack::UndoStack(QObject* parent)
+        : QObject(parent)
+    {
+    }
+
+
+    UndoStack::~UndoStack()
+    {
+        for (auto& command : commands_)
+        {
+            delete command;
+        }
+    }
+
+
+    void UndoStack::push(UndoCommand* command)
+    {
+        // Drop the redo history.
+        while (commands_.size() > index_)
+        {
+            UndoCommand* dropped = commands_.takeLast();
+            memory_usage_ -= dropped->cost();
+            delete dropped;
+        }
+
+        if (index_ > 0)
+        {
+            UndoCommand* last = commands_.at(index_ - 1);
+            qint64 const before = last->cost();
+            if ((command->id() >= 0) and (last->id() == command->id()) and last->mergeWith(command))
+            {
+                delete command;
+                memory_usage_ += last->cost() - before;
+                notify();
+                return;
+            }
+        }
+
+        commands_.append(command);
+        memory_usage_ += command->cost();
+        ++index_;
+
+        // Pack the entry that just became old.
+        compressAt(index_ - 1 - uncompressed_entries_);
+
+        evict();
+        notify();
+    }
+
+
+    void UndoStack::undo()
+    {
+        if (not canUndo())
+        {
+            return;
+        }
+
+        --index_;
+        replay(commands_.at(index_), true);
+
+        // The replayed entry is unpacked: pack the one leaving the window on the redo side.
+        compressAt(index_ + uncompressed_entries_);
+        notify();
+    }
+
+
+    void UndoStack::redo()
+    {
+        if (not canRedo())
+        {
+            return;
+        }
+
+        replay(commands_.at(index_), false);
+        ++index_;
+
+        // The replayed entry is unpacked: pack the one falling behind the window on the undo side.
+        compressAt(index_ - 1 - uncompressed_entries_);
+        notify();
+    }
+
+
+    void UndoStack::clear()
+    {
+        for (auto& command : commands_)
+        {
+            delete command;
+        }
+        commands_.clear();
+        index_ = 0;
+        memory_usage_ = 0;
+        notify();
+    }
+
+
+    void UndoStack::setLimits(qint64 maxBytes, int maxEntries)
+    {
+        max_bytes_ = maxBytes;
+        max_entries_ = maxEntries;
+        evict();
+        notify();
+    }
+
+
+    void UndoStack::replay(UndoCommand* command, bool undo)
+    {
+        // The command cost may change: i.e. removed items data is saved when they are erased.
+        qint64 const before = command->cost();
+
+        replaying_ = true;
+        if (undo)
+        {
+            command->undo();
+        }
+        else
+        {
+            command->redo();
+        }
+        replaying_ = false;
+
+        memory_usage_ += command->cost() - before;
+    }
+
+
+    void UndoStack::compressAt(int position)
+    {
+        if ((position < 0) or (position >= commands_.size()))
+        {
+            return;
+        }
+
+        UndoCommand* command = commands_.at(position);
+        qint64 const before = command->cost();
+        command->compress();
+        memory_usage_ += command->cost() - before;
+    }
+
+
+    void UndoStack::evict()
+    {
+        while ((index_ > 1) and ((commands_.size() > max_entries_) or (memory_usage_ > max_bytes_)))
+        {
+            UndoCommand* oldest = commands_.takeFirst();
+            memory_usage_ -= oldest->cost();
+            delete oldest;
+            --index_;
+        }
+    }
+
+
+    void UndoStack::notify()
+    {
+        emit memoryUsageChanged(memory_usage_);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef PIPER_UNDO_STACK_H
+#define PIPER_UNDO_STACK_H
+
+#include <QObject>
+#include <QVector>
+
+namespace piper
+{
+    /// \brief A reversible edit of the scene.
+    /// A command only describes the items it touches: undo/redo cost is proportional to the edit, not to the graph.
+    class UndoCommand
+    {
+    public:
+        UndoCommand() = default;
+        virtual ~UndoCommand() = default;
+
+        virtual void undo() = 0;
+        virtual void redo() = 0;
+
+        // Consecutive commands sharing the same non negative id may be merged into one entry.
+        virtual int id() const { return -1; }
+        virtual bool mergeWith(UndoCommand const*) { return false; }
+
+        // Approximate memory used by the command, in bytes.
+        virtual qint64 cost() const { return sizeof(*this); }
+
+        // Called when the command gets old: heavy data may be packed until the command is replayed.
+        virtual void compress() {}
+    };
+
+
+    /// \brief History of a scene, bounded by an entry count and a memory budget.
+    class UndoStack : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        static constexpr qint64 defaultMaxBytes   = 64 * 1024 * 1024;
+        static constexpr int    defaultMaxEntries = 1000;
+        static constexpr int    defaultUncompressedEntries = 16;
+
+        UndoStack(QObject* parent = nullptr);
+        virtual ~UndoStack();
+
+        // Take ownership of a command whose edit was already applied to the scene.
+        // Pushing a command discards the redo history.
+        void push(UndoCommand* command);
+
+        void undo();
+        void redo();
+        void clear();
+
+        bool canUndo() const { return index_ > 0; }
+        bool canRedo() const { return index_ < commands_.size(); }
+        int count() const    { return commands_.size(); }
+
+        // True while a command is undone or redone: edits made during that time shall not be recorded.
+        bool isReplaying() const { return replaying_; }
+
+        // Oldest entries are evicted when one of the limits is exceeded (the last edit is always kept).
+        void setLimits(qint64 maxBytes, int maxEntries);
+        qint64 maxBytes() const { return max_bytes_;   }
+        int maxEntries() const  { return max_entries_; }
+
+        // Entries farther than the given depth from the current position (undo or redo side) are compressed.
+        void setUncompressedEntries(int entries) { uncompressed_entries_ = entries; }
+
+        // Approximate memory used by the history, in bytes.
+        qint64 memoryUsage() const { return memory_usage_; }
+
+    signals:
+        void memoryUsageChanged(qint64 bytes);
+
+    private:
+        void replay(UndoCommand* command, bool undo);
+
+        // Compress the entry at the given position, if any (a packed entry is left as is).
+        void compressAt(int position);
+        void evict();
+        void notify();
+
+        QVector<UndoCommand*> commands_;
+        int index_{0};  // number of applied commands
+        bool replaying_{false};
+
+        qint64 max_bytes_{defaultMaxBytes};
+        int max_entries_{defaultMaxEntries};
+        int uncompressed_entries_{defaultUncompressedEntries};
+        qint64 memory_usage_{0};
+    };
+}
+
+#endif
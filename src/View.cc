@@ -3,13 +3,20 @@
 #include "Node.h"
 #include "Link.h"
 #include "CreatorPopup.h"
+#include "Commands.h"
+#include "Profiler.h"
 
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPainter>
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QScrollBar>
 #include <QGraphicsItem>
 #include <QDebug>
 
+#include <algorithm>
+
 namespace piper
 {
     QByteArray View::copy_{};
@@ -95,6 +102,18 @@ namespace piper
             redo();
             event->accept();
         }
+        if (event->key() == Qt::Key::Key_F3)
+        {
+            if (event->modifiers() & Qt::ShiftModifier)
+            {
+                saveTrace();
+            }
+            else
+            {
+                toggleProfiler();
+            }
+            event->accept();
+        }
 
         QGraphicsView::keyPressEvent(event);
     }
@@ -117,6 +136,7 @@ namespace piper
 
     void View::mouseMoveEvent(QMouseEvent* event)
     {
+        ProfileScope profile{"View::mouseMoveEvent"};
         if (pan_)
         {
             horizontalScrollBar()->setValue(horizontalScrollBar()->value() - (event->x() - panStartX_));
@@ -143,6 +163,136 @@ namespace piper
     }
 
 
+    void View::paintEvent(QPaintEvent* event)
+    {
+        Profiler& profiler = Profiler::instance();
+        if (not profiler.isEnabled())
+        {
+            QGraphicsView::paintEvent(event);
+            return;
+        }
+
+        qint64 const start = profiler.now();
+        QGraphicsView::paintEvent(event);
+        profiler.endFrame(start, profiler.now() - start);
+
+        // The HUD is only painted in the exposed area: after a partial update, repaint it whole or it would show
+        // figures of two frames. The repaint covers it, hence does not schedule another one.
+        if (not event->region().contains(hud_area_))
+        {
+            viewport()->update(hud_area_);
+        }
+    }
+
+
+    void View::drawForeground(QPainter* painter, QRectF const& rect)
+    {
+        QGraphicsView::drawForeground(painter, rect);
+        if (Profiler::instance().isEnabled()) // the profiler is global: every view shows its HUD
+        {
+            drawProfilerHud(painter);
+        }
+    }
+
+
+    void View::toggleProfiler()
+    {
+        Profiler& profiler = Profiler::instance();
+        profiler.setEnabled(not profiler.isEnabled());
+        hud_area_ = {};
+        viewport()->update();
+    }
+
+
+    void View::saveTrace()
+    {
+        Profiler const& profiler = Profiler::instance();
+        if (profiler.eventCount() == 0)
+        {
+            QMessageBox::information(this, "Trace", "Nothing recorded: press F3 to start profiling.");
+            return;
+        }
+
+        QString filename = QFileDialog::getSaveFileName(this, tr("Save trace"), "piper_trace.json",
+                                                        tr("Chrome trace (*.json);;All Files (*)"));
+        if (filename.isEmpty())
+        {
+            return; // nothing to do: user abort.
+        }
+
+        QString error;
+        if (not profiler.writeTrace(filename, error))
+        {
+            QMessageBox::warning(this, "Trace", error);
+        }
+    }
+
+
+    void View::drawProfilerHud(QPainter* painter)
+    {
+        Profiler const& profiler = Profiler::instance();
+        auto ms = [](qint64 ns) { return QString::number(ns / 1.0e6, 'f', 2) + " ms"; };
+
+        QStringList lines;
+        QVector<qint64> const& frames = profiler.frameTimes();
+        if (not frames.isEmpty())
+        {
+            qint64 total = 0;
+            qint64 worst = 0;
+            for (auto frame : frames)
+            {
+                total += frame;
+                worst = std::max(worst, frame);
+            }
+            lines << QString("frame        %1 (avg %2, max %3)").arg(ms(frames.last()), ms(total / frames.size()), ms(worst));
+        }
+        lines << QString("mouse move   %1").arg(ms(profiler.lastDuration("View::mouseMoveEvent")));
+        lines << QString("link refresh %1").arg(ms(profiler.lastDuration("Scene::processPendingUpdates")));
+        lines << QString("highlight    %1").arg(ms(profiler.lastDuration("Scene::highlightCompatible")));
+
+        // Paint counts of the last frame, per item type.
+        QHash<QByteArray, Profiler::Stat> const& frame = profiler.lastFrame();
+        QList<QByteArray> names = frame.keys();
+        std::sort(names.begin(), names.end());
+        for (auto const& name : names)
+        {
+            if (name.endsWith("::paint") or name.endsWith("::drawBackground"))
+            {
+                Profiler::Stat const& stat = frame[name];
+                lines << QString("%1 %2 x %3").arg(QString(name).leftJustified(22)).arg(stat.count, 5).arg(ms(stat.total));
+            }
+        }
+        lines << QString("%1 events (F3: hide, Shift+F3: save trace)").arg(profiler.eventCount());
+
+        painter->save();
+        painter->resetTransform();
+
+        QFont font("Monospace", 9);
+        font.setStyleHint(QFont::TypeWriter);
+        painter->setFont(font);
+        QFontMetrics metrics(font);
+
+        int width = 0;
+        for (auto const& line : lines)
+        {
+            width = std::max(width, metrics.boundingRect(line).width());
+        }
+        hud_area_ = hud_area_.united(QRect(8, 8, width + 16, metrics.lineSpacing() * lines.size() + 12));
+        QRect const area = hud_area_;
+        painter->fillRect(area, QColor(0, 0, 0, 180));
+
+        painter->setPen(QColor(220, 220, 220));
+        int y = area.top() + 6 + metrics.ascent();
+        for (auto const& line : lines)
+        {
+            painter->drawText(area.left() + 8, y, line);
+            y += metrics.lineSpacing();
+        }
+
+        painter->restore();
+    }
+
+
     void View::copy()
     {
         Scene* pScene = static_cast<Scene*>(scene());
@@ -193,14 +343,6 @@ namespace piper
             item->setZValue(-1);
         }
 
-        struct LinkData
-        {
-            QString from;
-            QString output;
-            QString to;
-            QString input;
-        };
-
         QDataStream stream(copy_);
         QList<Node*> copies;
         QList<LinkData> links;
@@ -226,28 +368,34 @@ namespace piper
 
 
         // compute unique name and insert nodes
+        bool const bulk = pScene->isBulkUpdateWorth(copies.size() + links.size());
+        if (bulk)
+        {
+            pScene->beginBulkUpdate();
+        }
         for (auto const& copy : copies)
         {
-            for (auto const& node : pScene->nodes())
+            if (pScene->findNode(copy->name()) != nullptr)
             {
-                if (copy->name() == node->name())
+                QString oldName = copy->name();
+                int suffix = pScene->nodes().size();
+                QString newName = oldName + "_" + QString::number(suffix);
+                while (pScene->findNode(newName) != nullptr)
                 {
-                    QString oldName = copy->name();
-                    QString newName = copy->name() + "_" + QString::number(pScene->nodes().size());
-                    copy->setName(newName);
-
-                    for (auto& link : links)
-                    {
-                        if (link.from == oldName) { link.from = newName; }
-                        if (link.to   == oldName) { link.to   = newName; }
-                        qDebug() << "rename link !" << oldName << " " << newName;
-                    }
-                    break;
+                    newName = oldName + "_" + QString::number(++suffix);
+                }
+                copy->setName(newName);
+
+                for (auto& link : links)
+                {
+                    if (link.from == oldName) { link.from = newName; }
+                    if (link.to   == oldName) { link.to   = newName; }
                 }
             }
             copy->setSelected(true);
             copy->setZValue(1);
             pScene->addNode(copy);
+            pScene->applyStageColor(copy);
         }
 
         // copy links
@@ -277,8 +425,15 @@ namespace piper
         }
 
 
-        // refresh
-        pScene->onStageUpdated();
+        if (bulk)
+        {
+            pScene->endBulkUpdate();
+        }
+
+        if (not copies.isEmpty())
+        {
+            pScene->undoStack().push(new AddItemsCommand(pScene, copies, links.toVector()));
+        }
     }
 
 
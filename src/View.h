@@ -18,6 +18,10 @@ namespace piper
         // Center the view on the items.
         void goHome();
 
+        // Copy the selected items in the editor clipboard / paste it at the cursor position (undoable).
+        void copy();
+        void paste();
+
     protected:
         void wheelEvent(QWheelEvent* event) override;
         void keyPressEvent(QKeyEvent * event) override;
@@ -26,13 +30,20 @@ namespace piper
         void mousePressEvent(QMouseEvent *event) override;
         void mouseReleaseEvent(QMouseEvent *event) override;
 
+        void paintEvent(QPaintEvent* event) override;
+        void drawForeground(QPainter* painter, QRectF const& rect) override;
+
     private:
-        void copy();
-        void paste();
         void undo();
         void redo();
 
+        // Profiler HUD (F3) and trace dump (Shift+F3).
+        void toggleProfiler();
+        void saveTrace();
+        void drawProfilerHud(QPainter* painter);
+
         CreatorPopup* creator_;
+        QRect hud_area_;        // viewport area of the HUD: it only grows, for the repaints to converge
         bool pan_{false};
         int panStartX_{};
         int panStartY_{};
@@ -0,0 +1,535 @@
+#include "CborExport.h"
+#include "ExampleNodes.h"
+#include "JsonExport.h"
+#include "JsonStreamExport.h"
+#include "Scene.h"
+#include "View.h"
+#include "Node.h"
+#include "Link.h"
+#include "Commands.h"
+#include "ThemeManager.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMap>
+#include <QPainter>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+using namespace piper;
+
+namespace
+{
+    // Shape of a synthetic pipeline.
+    struct Case
+    {
+        int nodes;
+        int fan;        // links per input (fan-in), the fan-out grows with it
+        int stages;
+        int modes;
+    };
+
+    // Generate a pipeline in the JSON import format with the example node types.
+    // Links always go from a node to a later one: the pipeline is acyclic and every link is valid.
+    QJsonObject generatePipeline(Case const& c, unsigned int seed)
+    {
+        std::mt19937 random(seed);
+
+        QJsonArray stages;
+        for (int i = 0; i < c.stages; ++i)
+        {
+            stages.append("stage_" + QString::number(i));
+        }
+
+        QJsonObject steps;
+        QJsonArray links;
+        QStringList producers; // nodes with a float output
+        int const sources = std::max(1, c.nodes / 10);
+        for (int i = 0; i < c.nodes; ++i)
+        {
+            QString const name = "node_" + QString::number(i);
+            QJsonObject step;
+            QStringList inputs;
+            bool producer = true;
+
+            if (i < sources)
+            {
+                if (i % 2)
+                {
+                    step["type"] = "SinWave";
+                    step["amplitude"] = 1.0 + i % 7;
+                    step["frequency"] = 50.0;
+                }
+                else
+                {
+                    step["type"] = "Random";
+                    step["min"] = -1.0;
+                    step["max"] = 1.0;
+                }
+            }
+            else if (i % 10 == 0)
+            {
+                step["type"] = "probe<float>";
+                inputs << "input";
+                producer = false;
+            }
+            else if (i % 2)
+            {
+                step["type"] = "Add";
+                inputs << "inputA" << "inputB";
+            }
+            else
+            {
+                step["type"] = "LowPass";
+                step["Fc"] = 10.0 + i % 100;
+                inputs << "inputA";
+            }
+
+            if (c.stages > 0)
+            {
+                step["stage"] = stages[static_cast<int>(static_cast<qint64>(i) * c.stages / c.nodes)];
+            }
+            steps[name] = step;
+
+            for (auto const& input : inputs)
+            {
+                // Distinct sources for the same input (duplicated links are rejected).
+                QSet<int> used;
+                int const fan = std::min(c.fan, producers.size());
+                while (used.size() < fan)
+                {
+                    std::uniform_int_distribution<int> pick(0, producers.size() - 1);
+                    int const from = pick(random);
+                    if (used.contains(from))
+                    {
+                        continue;
+                    }
+                    used.insert(from);
+
+                    QJsonObject link;
+                    link["from"] = producers[from];
+                    link["out"]  = "output";
+                    link["to"]   = name;
+                    link["in"]   = input;
+                    links.append(link);
+                }
+            }
+
+            if (producer)
+            {
+                producers << name;
+            }
+        }
+
+        // Each mode disables or neutralizes one node out of ten.
+        QJsonObject modes;
+        std::uniform_int_distribution<int> pickNode(0, c.nodes - 1);
+        for (int m = 0; m < c.modes; ++m)
+        {
+            QJsonObject configuration;
+            for (int i = 0; i < c.nodes / 10; ++i)
+            {
+                configuration["node_" + QString::number(pickNode(random))] = (i % 2) ? "Disable" : "Neutral";
+            }
+            QJsonObject mode;
+            mode["configuration"] = configuration;
+            modes["mode_" + QString::number(m)] = mode;
+        }
+        if (c.modes > 0)
+        {
+            modes["default"] = "mode_0";
+        }
+
+        QJsonObject pipeline;
+        pipeline["Stages"] = stages;
+        pipeline["Steps"] = steps;
+        pipeline["Links"] = links;
+        pipeline["Modes"] = modes;
+        return pipeline;
+    }
+
+    // Timings of one metric (milliseconds).
+    struct Samples
+    {
+        QVector<double> values;
+
+        void add(qint64 ns) { values.append(ns / 1.0e6); }
+
+        QJsonObject toJson() const
+        {
+            QVector<double> sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0;
+            for (double v : sorted) { sum += v; }
+
+            QJsonObject json;
+            json["min"]     = sorted.first();
+            json["median"]  = sorted.at(sorted.size() / 2);
+            json["mean"]    = sum / sorted.size();
+            json["max"]     = sorted.last();
+            json["samples"] = sorted.size();
+            return json;
+        }
+    };
+
+    qint64 measure(std::function<void()> const& run)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        return timer.nsecsElapsed();
+    }
+
+    void selectAll(Scene& scene)
+    {
+        for (auto const& item : scene.items())
+        {
+            if (item->flags() & QGraphicsItem::ItemIsSelectable)
+            {
+                item->setSelected(true);
+            }
+        }
+    }
+
+    QJsonObject runCase(Case const& c, int repeat, QString const& workDir, QTextStream& out)
+    {
+        QJsonObject const pipeline = generatePipeline(c, 42);
+        QMap<QString, Samples> metrics;
+
+        for (int r = 0; r < repeat; ++r)
+        {
+            QJsonObject json = pipeline;
+            View view;
+            view.resize(1920, 1080);
+            Scene* scene = new Scene(&view);
+            view.setScene(scene);
+
+            // -------- JSON import -------- //
+            metrics["json_import"].add(measure([&]() { scene->onImportJson(json); }));
+            QCoreApplication::processEvents(); // flush deferred layouts
+
+            // -------- .piper save / load -------- //
+            QByteArray project;
+            metrics["piper_save"].add(measure([&]()
+            {
+                QDataStream stream(&project, QIODevice::WriteOnly);
+                stream << *scene;
+            }));
+
+            {
+                Scene loaded;
+                metrics["piper_load"].add(measure([&]()
+                {
+                    QDataStream stream(project);
+                    stream >> loaded;
+                }));
+                metrics["piper_bytes"].values.append(project.size());
+            }
+
+            // -------- JSON export -------- //
+            metrics["json_export"].add(measure([&]()
+            {
+                QString const filename = workDir + "/export.json";
+                JsonExport backend;
+                backend.init(filename);
+                backend.startPipeline("bench");
+                scene->onExport(backend);
+                backend.endPipeline("bench");
+                backend.finalize(filename);
+            }));
+
+            metrics["json_stream_export"].add(measure([&]()
+            {
+                QString const filename = workDir + "/export_stream.json";
+                JsonStreamExport backend;
+                backend.init(filename);
+                backend.startPipeline("bench");
+                scene->onExport(backend);
+                backend.endPipeline("bench");
+                backend.finalize(filename);
+            }));
+
+            QString const cborFile = workDir + "/export.cbor";
+            metrics["cbor_export"].add(measure([&]()
+            {
+                CborExport backend;
+                backend.init(cborFile);
+                backend.startPipeline("bench");
+                scene->onExport(backend);
+                backend.endPipeline("bench");
+                backend.finalize(cborFile);
+            }));
+            metrics["cbor_read"].add(measure([&]()
+            {
+                Project project;
+                QStringList errors;
+                readCborFile(cborFile, project, errors);
+            }));
+
+            // -------- link drag highlight -------- //
+            QVector<Attribute*> outputs;
+            for (auto const& node : scene->nodes())
+            {
+                for (auto const& attribute : node->attributes())
+                {
+                    if (attribute->isOutput())
+                    {
+                        outputs.append(attribute);
+                    }
+                }
+            }
+            int const step = std::max(1, outputs.size() / 32);
+            for (int i = 0; i < outputs.size(); i += step)
+            {
+                metrics["highlight"].add(measure([&]()
+                {
+                    scene->highlightCompatible(outputs[i]);
+                    scene->clearHighlight();
+                }));
+            }
+
+            // -------- offscreen rendering -------- //
+            QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+            metrics["render_overview"].add(measure([&]()
+            {
+                QPainter painter(&image);
+                scene->render(&painter, image.rect(), scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+            }));
+            metrics["render_detail"].add(measure([&]()
+            {
+                QPainter painter(&image);
+                QRectF const area(scene->itemsBoundingRect().topLeft(), QSizeF(image.size()));
+                scene->render(&painter, image.rect(), area);
+            }));
+
+            // -------- copy / paste -------- //
+            selectAll(*scene);
+            metrics["copy"].add(measure([&]() { view.copy(); }));
+            metrics["paste"].add(measure([&]()
+            {
+                view.paste();
+                QCoreApplication::processEvents();
+            }));
+
+            // -------- undo / redo (the paste then the removal of every node) -------- //
+            metrics["undo_paste"].add(measure([&]() { scene->undo(); }));
+            metrics["redo_paste"].add(measure([&]() { scene->redo(); }));
+
+            QList<Node*> nodes = scene->nodes().toList();
+            metrics["remove_all"].add(measure([&]()
+            {
+                UndoCommand* command = new RemoveItemsCommand(scene, nodes, {});
+                command->redo();
+                scene->undoStack().push(command);
+            }));
+            metrics["undo_remove_all"].add(measure([&]() { scene->undo(); }));
+            metrics["redo_remove_all"].add(measure([&]() { scene->redo(); }));
+        }
+
+        QJsonObject shape;
+        shape["nodes"]  = c.nodes;
+        shape["fan"]    = c.fan;
+        shape["stages"] = c.stages;
+        shape["modes"]  = c.modes;
+        shape["links"]  = pipeline["Links"].toArray().size();
+
+        QJsonObject results;
+        out << "nodes " << c.nodes << ", fan " << c.fan << ", stages " << c.stages << ", modes " << c.modes
+            << " (" << shape["links"].toInt() << " links)" << endl;
+        for (auto it = metrics.constBegin(); it != metrics.constEnd(); ++it)
+        {
+            QJsonObject const stats = it.value().toJson();
+            results[it.key()] = stats;
+            out << "    " << it.key().leftJustified(18) << QString::number(stats["median"].toDouble(), 'f', 3)
+                << (it.key().endsWith("bytes") ? "" : " ms") << endl;
+        }
+
+        QJsonObject result;
+        result["case"] = shape;
+        result["metrics"] = results;
+        return result;
+    }
+
+    // Two pipelines sharing names (interned once for the file), with a converted link (int -> float), modes and a
+    // default mode.
+    Project roundTripProject()
+    {
+        Project project(2);
+        for (int i = 0; i < project.size(); ++i)
+        {
+            Pipeline& pipeline = project[i];
+            pipeline.name = "pipeline_" + QString::number(i);
+            QString const probe = "probe_" + QString::number(i);
+
+            Graph& graph = pipeline.graph;
+            graph.addStage({"acquisition", Qt::red});
+            graph.addStage({"processing", Qt::blue});
+            if (i == 0)
+            {
+                graph.createNode("SinWave", "source", "acquisition")->setData("amplitude", 2.5);
+            }
+            else
+            {
+                graph.createNode("Random", "source", "acquisition")->setData("max", 2.5);
+            }
+            graph.createNode("cast<float, int>", "cast", "processing");
+            graph.createNode("probe<float>", probe, "processing");
+            graph.addLink({"source", "output", "cast", "input"});
+            graph.addLink({"cast", "output", probe, "input"});
+
+            GraphMode nominal;
+            nominal.name = "nominal";
+            nominal.isDefault = (i == 0);
+            graph.addMode(nominal);
+
+            GraphMode degraded;
+            degraded.name = "degraded_" + QString::number(i);
+            degraded.nodes.insert("cast", Mode::neutral);
+            degraded.nodes.insert(probe, Mode::disable);
+            degraded.isDefault = (i == 1);
+            graph.addMode(degraded);
+        }
+        return project;
+    }
+
+    // JSON export of the project: its keys are sorted, the content can be compared whatever the write order.
+    QByteArray exportJson(Project const& project, QString const& filename)
+    {
+        JsonExport backend;
+        if (not exportProject(project, backend, filename))
+        {
+            return {};
+        }
+
+        QFile file(filename);
+        if (not file.open(QIODevice::ReadOnly))
+        {
+            return {};
+        }
+        return file.readAll();
+    }
+
+    // Write a project in CBOR, read it back and compare both.
+    bool checkCborRoundTrip(QString const& workDir, QTextStream& out)
+    {
+        Project const project = roundTripProject();
+        QString const cborFile = workDir + "/roundtrip.cbor";
+        CborExport backend;
+        if (not exportProject(project, backend, cborFile))
+        {
+            out << "CBOR round trip failed: cannot write " << cborFile << endl;
+            return false;
+        }
+
+        Project read;
+        QStringList errors;
+        if ((not readCborFile(cborFile, read, errors)) or (not errors.isEmpty()))
+        {
+            out << "CBOR round trip failed: " << errors.join("; ") << endl;
+            return false;
+        }
+
+        QByteArray const expected = exportJson(project, workDir + "/roundtrip_written.json");
+        if (expected.isEmpty() or (expected != exportJson(read, workDir + "/roundtrip_read.json")))
+        {
+            out << "CBOR round trip failed: the read project differs from the written one" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    QVector<int> toIntList(QString const& values)
+    {
+        QVector<int> list;
+        for (auto const& value : values.split(',', QString::SkipEmptyParts))
+        {
+            list.append(value.toInt());
+        }
+        return list;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    registerExampleNodes();
+    if (not ThemeManager::instance().load("data/theme.json"))
+    {
+        return 1;
+    }
+
+    QApplication app(argc, argv);
+    Q_INIT_RESOURCE(resources);
+    QCoreApplication::setApplicationName("piper_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark the editor on synthetic pipelines.\n"
+                                     "Every combination of the lists is run; times are in milliseconds.");
+    parser.addHelpOption();
+    QCommandLineOption nodesOption("nodes",   "Node counts (comma separated).",  "list", "100,1000,5000");
+    QCommandLineOption fanOption("fan",       "Links per input.",                "list", "1,4");
+    QCommandLineOption stagesOption("stages", "Stage counts.",                   "list", "4");
+    QCommandLineOption modesOption("modes",   "Mode counts.",                    "list", "2");
+    QCommandLineOption repeatOption("repeat", "Runs per case.",                  "n",    "3");
+    QCommandLineOption outputOption({"o", "output"}, "Result file (JSON).",      "file", "piper_bench.json");
+    parser.addOptions({nodesOption, fanOption, stagesOption, modesOption, repeatOption, outputOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTemporaryDir workDir;
+    int const repeat = std::max(1, parser.value(repeatOption).toInt());
+
+    // The timings of a broken format are meaningless.
+    if (not checkCborRoundTrip(workDir.path(), out))
+    {
+        return 1;
+    }
+
+    QJsonArray results;
+    for (int nodes : toIntList(parser.value(nodesOption)))
+    {
+        for (int fan : toIntList(parser.value(fanOption)))
+        {
+            for (int stages : toIntList(parser.value(stagesOption)))
+            {
+                for (int modes : toIntList(parser.value(modesOption)))
+                {
+                    results.append(runCase({nodes, fan, stages, modes}, repeat, workDir.path(), out));
+                }
+            }
+        }
+    }
+
+    QJsonObject report;
+    report["qt"]        = qVersion();
+    report["date"]      = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["repeat"]    = repeat;
+    report["results"]   = results;
+
+    QFile file(parser.value(outputOption));
+    if (not file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        out << "Cannot write " << file.fileName() << endl;
+        return 1;
+    }
+    file.write(QJsonDocument(report).toJson());
+    out << "Results written in " << file.fileName() << endl;
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "CborExport.h"
+#include "ExampleNodes.h"
+#include "JsonExport.h"
+#include "JsonStreamExport.h"
+#include "Project.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <functional>
+#include <memory>
+
+using namespace piper;
+
+namespace
+{
+    // Export backends available from the command line: format name -> factory.
+    QMap<QString, std::function<std::unique_ptr<ExportBackend>()>> const& backends()
+    {
+        static QMap<QString, std::function<std::unique_ptr<ExportBackend>()>> const factories
+        {
+            {"cbor",        []() { return std::unique_ptr<ExportBackend>(new CborExport);       }},
+            {"json",        []() { return std::unique_ptr<ExportBackend>(new JsonExport);       }},
+            {"json-stream", []() { return std::unique_ptr<ExportBackend>(new JsonStreamExport); }},
+        };
+        return factories;
+    }
+
+    struct Options
+    {
+        QString format;     // output format: "piper" or a backend name (empty: .piper <-> json)
+        QString outputDir;  // empty: next to the input file
+        bool checkOnly;     // validate without writing anything
+        bool force;         // write the output even if the validation failed or over the input file
+    };
+
+    struct Report
+    {
+        QString input;
+        QString output;
+        QStringList errors;
+        bool success{false};
+        qint64 loadTime{0};     // ns
+        qint64 validateTime{0}; // ns
+        qint64 writeTime{0};    // ns
+    };
+
+    QString outputFile(QString const& input, QString const& format, Options const& options)
+    {
+        QFileInfo info(input);
+        QString dir = options.outputDir.isEmpty() ? info.absolutePath() : options.outputDir;
+        QString const suffix = format.section('-', 0, 0); // variants of a format share its suffix
+        return QDir(dir).filePath(info.completeBaseName() + "." + suffix);
+    }
+
+    Report process(QString const& input, Options const& options)
+    {
+        Report report;
+        report.input = input;
+        QElapsedTimer timer;
+
+        // -------- load -------- //
+        timer.start();
+        Project project;
+        bool const isProject = input.endsWith(".piper");
+        if (isProject)
+        {
+            QString error;
+            if (not readProjectFile(input, project, error))
+            {
+                report.errors.append(error);
+                return report;
+            }
+        }
+        else if (input.endsWith(".cbor"))
+        {
+            if (not readCborFile(input, project, report.errors))
+            {
+                return report;
+            }
+        }
+        else if (not readJsonFile(input, project, report.errors))
+        {
+            return report;
+        }
+        report.loadTime = timer.nsecsElapsed();
+
+        // -------- validate -------- //
+        timer.restart();
+        for (auto const& pipeline : project)
+        {
+            for (auto const& error : pipeline.graph.validate())
+            {
+                report.errors.append(pipeline.name + ": " + error);
+            }
+        }
+        report.validateTime = timer.nsecsElapsed();
+
+        bool const valid = report.errors.isEmpty();
+        if (options.checkOnly or (not valid and not options.force))
+        {
+            report.success = valid;
+            return report;
+        }
+
+        // -------- write -------- //
+        QString format = options.format;
+        if (format.isEmpty())
+        {
+            format = isProject ? "json" : "piper";
+        }
+        report.output = outputFile(input, format, options);
+        if ((QFileInfo(report.output).absoluteFilePath() == QFileInfo(input).absoluteFilePath()) and not options.force)
+        {
+            report.errors.append("The output would replace the input file " + input + ": use another format, "
+                                 "an output directory or --force");
+            return report;
+        }
+
+        timer.restart();
+        if (format == "piper")
+        {
+            QString error;
+            if (not writeProjectFile(report.output, project, error))
+            {
+                report.errors.append(error);
+                return report;
+            }
+        }
+        else
+        {
+            std::unique_ptr<ExportBackend> backend = backends().value(format)();
+            if (not exportProject(project, *backend, report.output))
+            {
+                report.errors.append("Cannot write " + report.output);
+                return report;
+            }
+        }
+        report.writeTime = timer.nsecsElapsed();
+
+        report.success = valid or options.force;
+        return report;
+    }
+
+    QString ms(qint64 ns)
+    {
+        return QString::number(ns / 1.0e6, 'f', 3) + " ms";
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    // The pipeline model does not use the GUI: no display nor platform plugin needed.
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("piper_cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Convert, validate and export Piper pipelines (.piper, .json and .cbor files).\n"
+                                     "By default, .piper files are exported to JSON and exported files are "
+                                     "converted to .piper.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Pipelines to process.", "files...");
+
+    QStringList formats = backends().keys();
+    formats.prepend("piper");
+    QCommandLineOption formatOption({"f", "format"}, "Output format: " + formats.join(", ") + ".", "format");
+    QCommandLineOption outputOption({"o", "output-dir"}, "Write the outputs in this directory.", "dir");
+    QCommandLineOption checkOption({"c", "check"}, "Only validate the pipelines.");
+    QCommandLineOption forceOption("force", "Write the output even if the validation failed or if it replaces the "
+                                            "input file.");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of files processed in parallel (default: cores).", "n");
+    parser.addOptions({formatOption, outputOption, checkOption, forceOption, jobsOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    QStringList const files = parser.positionalArguments();
+    if (files.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+
+    Options options;
+    options.format    = parser.value(formatOption);
+    options.outputDir = parser.value(outputOption);
+    options.checkOnly = parser.isSet(checkOption);
+    options.force     = parser.isSet(forceOption);
+    if ((not options.format.isEmpty()) and (not formats.contains(options.format)))
+    {
+        err << "Unknown format " << options.format << ". Available: " << formats.join(", ") << "\n";
+        return 1;
+    }
+    if ((not options.outputDir.isEmpty()) and (not QDir().mkpath(options.outputDir)))
+    {
+        err << "Cannot create the output directory " << options.outputDir << "\n";
+        return 1;
+    }
+    if (parser.isSet(jobsOption))
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value(jobsOption).toInt()));
+    }
+
+    registerExampleNodes();
+
+    QElapsedTimer total;
+    total.start();
+    QList<Report> const reports = QtConcurrent::blockingMapped<QList<Report>>(files,
+        std::function<Report(QString const&)>([&options](QString const& file) { return process(file, options); }));
+
+    int failures = 0;
+    for (auto const& report : reports)
+    {
+        out << report.input << ": " << (report.success ? "ok" : "FAILED")
+            << " (load " << ms(report.loadTime) << ", validate " << ms(report.validateTime);
+        if (not report.output.isEmpty())
+        {
+            out << ", write " << ms(report.writeTime) << " -> " << report.output;
+        }
+        out << ")\n";
+
+        for (auto const& error : report.errors)
+        {
+            out << "    " << error << "\n";
+        }
+
+        if (not report.success)
+        {
+            ++failures;
+        }
+    }
+
+    out << reports.size() << " file(s), " << failures << " failure(s) in " << ms(total.nsecsElapsed())
+        << " (" << QThreadPool::globalInstance()->maxThreadCount() << " threads)\n";
+
+    out.flush();
+    return (failures == 0) ? 0 : 1;
+}